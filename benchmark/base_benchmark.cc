@@ -0,0 +1,116 @@
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "benchmark_corpus.h"
+#include "benchmark_counters.h"
+#include "image_io/base/data_context.h"
+#include "image_io/base/data_line_map.h"
+#include "image_io/base/data_match_result.h"
+#include "image_io/base/data_scanner.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/static_data_scanner.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+namespace {
+
+void BM_DataSegmentFindString(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> file =
+      GetBenchmarkFile(GetBenchmarkFileSpec(state));
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    // The string is not in the file, so all of the file is searched.
+    size_t location = file->Find(file->GetBegin(), "GDepth:Missing");
+    if (location != file->GetEnd()) {
+      state.SkipWithError("String found");
+      break;
+    }
+  }
+  SetPerFileCounters(file->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_DataSegmentFindString)->Apply(AddBenchmarkFileSpecArgs);
+
+void BM_DataSegmentFindByte(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> text =
+      GetBenchmarkBase64Text(GetBenchmarkTextSize(state));
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    // Base64 text has no quotes, so all of the text is searched.
+    size_t location = text->Find(text->GetBegin(), '"');
+    if (location != text->GetEnd()) {
+      state.SkipWithError("Byte found");
+      break;
+    }
+  }
+  SetPerFileCounters(text->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_DataSegmentFindByte)->Apply(AddBenchmarkTextSizeArgs);
+
+void BM_DataScannerTokens(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> text =
+      GetBenchmarkXmpText(GetBenchmarkTextSize(state));
+  const DataRange& range = text->GetDataRange();
+  DataLineMap data_line_map;
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    // Scan the text as a sequence of whitespace name = "value" tokens.
+    DataScanner scanners[] = {DataScanner::CreateWhitespaceScanner(),
+                              DataScanner::CreateNameScanner(),
+                              DataScanner::CreateLiteralScanner("="),
+                              DataScanner::CreateQuotedStringScanner()};
+    size_t location = range.GetBegin();
+    while (location < range.GetEnd() && !state.error_occurred()) {
+      for (auto& scanner : scanners) {
+        scanner.Reset();
+        DataContext context(location, range, *text, data_line_map);
+        DataMatchResult result = scanner.Scan(context);
+        if (result.GetType() != DataMatchResult::kFull) {
+          state.SkipWithError("Token not scanned");
+          break;
+        }
+        location += result.GetBytesConsumed();
+      }
+    }
+  }
+  SetPerFileCounters(text->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_DataScannerTokens)->Apply(AddBenchmarkTextSizeArgs);
+
+constexpr char kEquals[] = "=";
+
+void BM_StaticDataScannerTokens(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> text =
+      GetBenchmarkXmpText(GetBenchmarkTextSize(state));
+  const DataRange& range = text->GetDataRange();
+  DataLineMap data_line_map;
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    // The same tokens as above, scanned with a static grammar.
+    ScannerSequence<WhitespaceScanner, NameScanner, LiteralScanner<kEquals>,
+                    QuotedStringScanner>
+        property;
+    size_t location = range.GetBegin();
+    while (location < range.GetEnd()) {
+      property.Reset();
+      DataContext context(location, range, *text, data_line_map);
+      DataMatchResult result = property.Scan(context);
+      if (result.GetType() != DataMatchResult::kFull) {
+        state.SkipWithError("Token not scanned");
+        break;
+      }
+      location += result.GetBytesConsumed();
+    }
+  }
+  SetPerFileCounters(text->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_StaticDataScannerTokens)->Apply(AddBenchmarkTextSizeArgs);
+
+}  // namespace
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,172 @@
+#include "benchmark_corpus.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+
+#include "synthetic_jpeg_generator.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::shared_ptr;
+using std::string;
+
+namespace {
+
+const size_t kMegabyte = 1024 * 1024;
+
+/// The file size in MB, extended XMP segment count and image count of the
+/// standard set of file specs.
+const int64_t kFileSpecArgs[][3] = {
+    {1, 1, 2}, {1, 8, 3}, {10, 16, 4}, {10, 64, 2}, {50, 64, 3}, {50, 256, 4},
+};
+
+/// The sizes in MB of the standard set of texts.
+const int64_t kTextSizeArgs[] = {1, 10, 50};
+
+/// A small deterministic pseudo random number generator.
+class Random {
+ public:
+  Random() : state_(0x9E3779B9) {}
+
+  /// @return The next pseudo random byte value.
+  Byte NextByte() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return static_cast<Byte>(state_ & 0xFF);
+  }
+
+ private:
+  std::uint32_t state_;
+};
+
+/// @param size The number of bytes to encode.
+/// @param random The generator of the bytes to encode.
+/// @return The base64 encoded value of size pseudo random bytes.
+string GetRandomBase64(size_t size, Random* random) {
+  const char kBase64Chars[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  string base64;
+  base64.reserve((size + 2) / 3 * 4);
+  for (size_t index = 0; index < size; index += 3) {
+    size_t byte_count = std::min(size - index, static_cast<size_t>(3));
+    std::uint32_t bits = 0;
+    for (size_t byte_index = 0; byte_index < 3; ++byte_index) {
+      bits = bits << 8 | (byte_index < byte_count ? random->NextByte() : 0);
+    }
+    for (size_t char_index = 0; char_index < 4; ++char_index) {
+      base64 += char_index <= byte_count
+                    ? kBase64Chars[(bits >> (18 - 6 * char_index)) & 0x3F]
+                    : '=';
+    }
+  }
+  return base64;
+}
+
+/// @param data The data to put in the segment.
+/// @return A data segment holding a copy of the data.
+shared_ptr<DataSegment> CreateDataSegment(const string& data) {
+  Byte* buffer = nullptr;
+  auto data_segment =
+      DataSegment::CreateWithBuffer(DataRange(0, data.size()), &buffer);
+  memcpy(buffer, data.data(), data.size());
+  return data_segment;
+}
+
+}  // namespace
+
+void AddBenchmarkFileSpecArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"mb", "xmp", "images"});
+  for (const auto& args : kFileSpecArgs) {
+    benchmark->Args({args[0], args[1], args[2]});
+  }
+}
+
+void AddBenchmarkTextSizeArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgName("mb");
+  for (const auto& arg : kTextSizeArgs) {
+    benchmark->Arg(arg);
+  }
+}
+
+BenchmarkFileSpec GetBenchmarkFileSpec(const benchmark::State& state) {
+  BenchmarkFileSpec spec;
+  spec.file_size = static_cast<size_t>(state.range(0)) * kMegabyte;
+  spec.extended_xmp_count = static_cast<size_t>(state.range(1));
+  spec.image_count = static_cast<size_t>(state.range(2));
+  return spec;
+}
+
+size_t GetBenchmarkTextSize(const benchmark::State& state) {
+  return static_cast<size_t>(state.range(0)) * kMegabyte;
+}
+
+shared_ptr<DataSegment> GetBenchmarkFile(const BenchmarkFileSpec& spec) {
+  static auto* files =
+      new std::map<std::tuple<size_t, size_t, size_t>,  // NOLINT
+                   shared_ptr<DataSegment>>;
+  auto& file = (*files)[std::make_tuple(spec.file_size, spec.extended_xmp_count,
+                                        spec.image_count)];
+  if (!file) {
+    // The extended XMP segments hold about kExtendedXmpChunkSize bytes each,
+    // and half of the rest goes to the primary image. The secondary images are
+    // the Apple depth and matte images, followed by plain ones.
+    const size_t kChunkSize = SyntheticJpegGenerator::kExtendedXmpChunkSize;
+    size_t xmp_size = spec.extended_xmp_count * kChunkSize;
+    size_t image_size =
+        spec.file_size > xmp_size ? spec.file_size - xmp_size : 0;
+    size_t secondary_count = spec.image_count > 1 ? spec.image_count - 1 : 0;
+    size_t secondary_size =
+        secondary_count ? image_size / 2 / secondary_count : 0;
+    SyntheticJpegSpec jpeg_spec;
+    jpeg_spec.primary_image_size =
+        image_size - secondary_size * secondary_count;
+    if (xmp_size) {
+      jpeg_spec.gdepth_image_size = (xmp_size - 1024) / 4 * 3;
+    }
+    for (size_t image = 0; image < secondary_count; ++image) {
+      if (image == 0) {
+        jpeg_spec.apple_depth_image_size = secondary_size;
+      } else if (image == 1) {
+        jpeg_spec.apple_matte_image_size = secondary_size;
+      } else {
+        jpeg_spec.other_image_sizes.push_back(secondary_size);
+      }
+    }
+    file = SyntheticJpegGenerator(jpeg_spec).GenerateDataSegment();
+  }
+  return file;
+}
+
+shared_ptr<DataSegment> GetBenchmarkBase64Text(size_t size) {
+  static auto* texts = new std::map<size_t, shared_ptr<DataSegment>>;  // NOLINT
+  auto& text = (*texts)[size];
+  if (!text) {
+    Random random;
+    text = CreateDataSegment(GetRandomBase64(size / 4 * 3, &random));
+  }
+  return text;
+}
+
+shared_ptr<DataSegment> GetBenchmarkXmpText(size_t size) {
+  static auto* texts = new std::map<size_t, shared_ptr<DataSegment>>;  // NOLINT
+  auto& text = (*texts)[size];
+  if (!text) {
+    Random random;
+    string data;
+    for (size_t index = 0; data.size() < size; ++index) {
+      data += "\n  Benchmark:Property" + std::to_string(index % 1000) + "=\"" +
+              GetRandomBase64(3 * (index % 64), &random) + "\"";
+    }
+    text = CreateDataSegment(data);
+  }
+  return text;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,66 @@
+#ifndef IMAGE_IO_BENCHMARK_BENCHMARK_CORPUS_H_  // NOLINT
+#define IMAGE_IO_BENCHMARK_BENCHMARK_CORPUS_H_  // NOLINT
+
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "image_io/base/data_segment.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// The parameters of a synthetic JPEG file used by the benchmarks.
+struct BenchmarkFileSpec {
+  /// The approximate size of the file in bytes.
+  size_t file_size;
+
+  /// The number of extended XMP segments holding the GDepth:Data value of the
+  /// primary image. If zero, the file has no GDepth image.
+  size_t extended_xmp_count;
+
+  /// The number of images in the file. If more than one, the primary image has
+  /// an APP2/MPF segment, the second image is an Apple depth image and the
+  /// third one is an Apple matte image.
+  size_t image_count;
+};
+
+/// Adds the arguments of the standard set of BenchmarkFileSpecs to a benchmark.
+/// The specs cover files from 1 MB to 50 MB, with 1 to 256 extended XMP
+/// segments and 2 to 4 images.
+/// @param benchmark The benchmark to add the arguments to.
+void AddBenchmarkFileSpecArgs(benchmark::internal::Benchmark* benchmark);
+
+/// Adds the arguments of the standard set of text sizes to a benchmark.
+/// @param benchmark The benchmark to add the arguments to.
+void AddBenchmarkTextSizeArgs(benchmark::internal::Benchmark* benchmark);
+
+/// @param state The state of a benchmark that was given its arguments by the
+///     AddBenchmarkFileSpecArgs() function.
+/// @return The file spec defined by the state's arguments.
+BenchmarkFileSpec GetBenchmarkFileSpec(const benchmark::State& state);
+
+/// @param state The state of a benchmark that was given its arguments by the
+///     AddBenchmarkTextSizeArgs() function.
+/// @return The text size in bytes defined by the state's arguments.
+size_t GetBenchmarkTextSize(const benchmark::State& state);
+
+/// Returns a synthetic JPEG file made by the SyntheticJpegGenerator. The files
+/// are generated the first time they are requested and cached, so that the
+/// generation time is not measured.
+/// @param spec The spec of the file.
+/// @return The data segment holding the file.
+std::shared_ptr<DataSegment> GetBenchmarkFile(const BenchmarkFileSpec& spec);
+
+/// @param size The size of the text.
+/// @return A cached data segment holding base64 encoded text.
+std::shared_ptr<DataSegment> GetBenchmarkBase64Text(size_t size);
+
+/// @param size The approximate size of the text.
+/// @return A cached data segment holding a sequence of XMP style name="value"
+///     property definitions separated by white space.
+std::shared_ptr<DataSegment> GetBenchmarkXmpText(size_t size);
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BENCHMARK_BENCHMARK_CORPUS_H_  // NOLINT
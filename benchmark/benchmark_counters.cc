@@ -0,0 +1,55 @@
+#include "benchmark_counters.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+/// The number of calls to the replaced operator new functions.
+std::atomic<size_t> new_call_count(0);
+
+/// Counts and performs an allocation. There are no exceptions to throw, so
+/// running out of memory aborts the benchmark.
+/// @param size The number of bytes to allocate.
+/// @return The allocated memory.
+void* CountedAllocate(size_t size) {
+  new_call_count.fetch_add(1, std::memory_order_relaxed);
+  void* memory = std::malloc(size > 0 ? size : 1);
+  if (memory == nullptr) {
+    std::abort();
+  }
+  return memory;
+}
+
+}  // namespace
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t /*size*/) noexcept {
+  std::free(memory);
+}
+void operator delete[](void* memory, size_t /*size*/) noexcept {
+  std::free(memory);
+}
+
+namespace photos_editing_formats {
+namespace image_io {
+
+size_t GetAllocationCount() {
+  return new_call_count.load(std::memory_order_relaxed);
+}
+
+void SetPerFileCounters(size_t file_size, size_t allocation_count,
+                        benchmark::State* state) {
+  state->SetBytesProcessed(static_cast<int64_t>(state->iterations()) *
+                           static_cast<int64_t>(file_size));
+  state->counters["allocs_per_file"] = benchmark::Counter(
+      static_cast<double>(allocation_count),
+      benchmark::Counter::kAvgIterations);
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,27 @@
+#ifndef IMAGE_IO_BENCHMARK_BENCHMARK_COUNTERS_H_  // NOLINT
+#define IMAGE_IO_BENCHMARK_BENCHMARK_COUNTERS_H_  // NOLINT
+
+#include <cstddef>
+
+#include "benchmark/benchmark.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// @return The number of calls made to the global operator new functions since
+///     the start of the program. The benchmark binary replaces these functions
+///     with ones that count the calls.
+size_t GetAllocationCount();
+
+/// Sets the bytes processed and the "allocs_per_file" counter of a benchmark
+/// whose iterations each process one file (or one text).
+/// @param file_size The number of bytes processed by each iteration.
+/// @param allocation_count The number of allocations made by all iterations.
+/// @param state The state of the benchmark.
+void SetPerFileCounters(size_t file_size, size_t allocation_count,
+                        benchmark::State* state);
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BENCHMARK_BENCHMARK_COUNTERS_H_  // NOLINT
@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <memory>
+
+#include "benchmark/benchmark.h"
+#include "benchmark_corpus.h"
+#include "benchmark_counters.h"
+#include "image_io/base/data_range_tracking_destination.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/extras/base64_decoder_data_destination.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+namespace {
+
+/// The size of the ranges transferred to the decoder. It is about the size of
+/// the data in an extended XMP segment, as seen by the decoder when extracting
+/// GDepth/GImage images.
+const size_t kTransferSize = 65000;
+
+void BM_Base64DecoderDataDestination(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> text =
+      GetBenchmarkBase64Text(GetBenchmarkTextSize(state));
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    DataRangeTrackingDestination decoded_destination(nullptr);
+    Base64DecoderDataDestination decoder(&decoded_destination, nullptr);
+    decoder.StartTransfer();
+    for (size_t begin = text->GetBegin(); begin < text->GetEnd();
+         begin += kTransferSize) {
+      size_t end = std::min(begin + kTransferSize, text->GetEnd());
+      decoder.Transfer(DataRange(begin, end), *text);
+    }
+    decoder.FinishTransfer();
+    if (decoder.HasError()) {
+      state.SkipWithError("Decoding error");
+      break;
+    }
+  }
+  SetPerFileCounters(text->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_Base64DecoderDataDestination)->Apply(AddBenchmarkTextSizeArgs);
+
+}  // namespace
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
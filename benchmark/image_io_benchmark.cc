@@ -0,0 +1,7 @@
+#include "benchmark/benchmark.h"
+
+// The benchmarks are registered by the other files in this directory. Each
+// reports its throughput in bytes per second and, in the allocs_per_file
+// counter, the number of heap allocations made to process one file. Run the
+// binary with --benchmark_filter=<regex> to select a subset of them.
+BENCHMARK_MAIN();
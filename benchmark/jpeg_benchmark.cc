@@ -0,0 +1,148 @@
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "benchmark_corpus.h"
+#include "benchmark_counters.h"
+#include "image_io/base/data_destination.h"
+#include "image_io/base/data_segment_data_source.h"
+#include "image_io/jpeg/jpeg_image_extractor.h"
+#include "image_io/jpeg/jpeg_info_builder.h"
+#include "image_io/jpeg/jpeg_scanner.h"
+#include "image_io/jpeg/jpeg_segment_lister.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+namespace {
+
+/// @param data_source The data source of the file to scan.
+/// @return The JpegInfo of the file.
+JpegInfo GetJpegInfo(DataSource* data_source) {
+  JpegInfoBuilder info_builder;
+  JpegScanner scanner(nullptr);
+  scanner.Run(data_source, &info_builder);
+  return info_builder.GetInfo();
+}
+
+/// A destination that copies the bytes it is given to the end of a buffer, so
+/// that the extractor benchmarks measure the bytes moved to the caller. The
+/// buffer is reused by the transfers, and must be big enough for all of them.
+class BufferDataDestination : public DataDestination {
+ public:
+  /// @param buffer The buffer to copy the bytes to.
+  explicit BufferDataDestination(std::vector<Byte>* buffer)
+      : buffer_(buffer), bytes_transferred_(0) {}
+  void StartTransfer() override { bytes_transferred_ = 0; }
+  TransferStatus Transfer(const DataRange& transfer_range,
+                          const DataSegment& data_segment) override {
+    size_t byte_count = transfer_range.GetLength();
+    if (byte_count > buffer_->size() - bytes_transferred_) {
+      return kTransferError;
+    }
+    memcpy(buffer_->data() + bytes_transferred_,
+           data_segment.GetBuffer(transfer_range.GetBegin()), byte_count);
+    bytes_transferred_ += byte_count;
+    return kTransferOk;
+  }
+  void FinishTransfer() override {}
+  size_t GetBytesTransferred() const override { return bytes_transferred_; }
+
+ private:
+  std::vector<Byte>* buffer_;
+  size_t bytes_transferred_;
+};
+
+void BM_JpegScannerWithInfoBuilder(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> file =
+      GetBenchmarkFile(GetBenchmarkFileSpec(state));
+  DataSegmentDataSource data_source(file);
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    JpegInfoBuilder info_builder;
+    JpegScanner scanner(nullptr);
+    scanner.Run(&data_source, &info_builder);
+    if (scanner.HasError()) {
+      state.SkipWithError("JpegScanner error");
+      break;
+    }
+    benchmark::DoNotOptimize(info_builder.GetInfo());
+  }
+  SetPerFileCounters(file->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_JpegScannerWithInfoBuilder)->Apply(AddBenchmarkFileSpecArgs);
+
+void BM_JpegScannerWithSegmentLister(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> file =
+      GetBenchmarkFile(GetBenchmarkFileSpec(state));
+  DataSegmentDataSource data_source(file);
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    JpegSegmentLister segment_lister;
+    JpegScanner scanner(nullptr);
+    scanner.Run(&data_source, &segment_lister);
+    if (scanner.HasError()) {
+      state.SkipWithError("JpegScanner error");
+      break;
+    }
+    benchmark::DoNotOptimize(segment_lister.GetLines());
+  }
+  SetPerFileCounters(file->GetLength(), GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_JpegScannerWithSegmentLister)->Apply(AddBenchmarkFileSpecArgs);
+
+// The throughput of the extractor benchmarks is given in bytes of the extracted
+// images, not of the files they are extracted from.
+void BM_JpegImageExtractorAppleDepth(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> file =
+      GetBenchmarkFile(GetBenchmarkFileSpec(state));
+  DataSegmentDataSource data_source(file);
+  JpegInfo jpeg_info = GetJpegInfo(&data_source);
+  std::vector<Byte> image_buffer(file->GetLength());
+  size_t image_size = 0;
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    BufferDataDestination image_destination(&image_buffer);
+    JpegImageExtractor extractor(jpeg_info, &data_source, nullptr);
+    if (!extractor.ExtractAppleDepthImage(&image_destination)) {
+      state.SkipWithError("No Apple depth image");
+      break;
+    }
+    image_size = image_destination.GetBytesTransferred();
+    benchmark::DoNotOptimize(image_buffer.data());
+  }
+  SetPerFileCounters(image_size, GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_JpegImageExtractorAppleDepth)->Apply(AddBenchmarkFileSpecArgs);
+
+void BM_JpegImageExtractorGDepth(benchmark::State& state) {  // NOLINT
+  std::shared_ptr<DataSegment> file =
+      GetBenchmarkFile(GetBenchmarkFileSpec(state));
+  DataSegmentDataSource data_source(file);
+  JpegInfo jpeg_info = GetJpegInfo(&data_source);
+  std::vector<Byte> image_buffer(file->GetLength());
+  size_t image_size = 0;
+  size_t allocation_count = GetAllocationCount();
+  for (auto _ : state) {
+    BufferDataDestination image_destination(&image_buffer);
+    JpegImageExtractor extractor(jpeg_info, &data_source, nullptr);
+    if (!extractor.ExtractGDepthImage(&image_destination)) {
+      state.SkipWithError("No GDepth image");
+      break;
+    }
+    image_size = image_destination.GetBytesTransferred();
+    benchmark::DoNotOptimize(image_buffer.data());
+  }
+  SetPerFileCounters(image_size, GetAllocationCount() - allocation_count,
+                     &state);
+}
+BENCHMARK(BM_JpegImageExtractorGDepth)->Apply(AddBenchmarkFileSpecArgs);
+
+}  // namespace
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -66,6 +66,26 @@ class DataDestination {
   /// to transfer via the transfer_range parameter of the Transfer()
   /// function.
   virtual size_t GetBytesTransferred() const = 0;
+
+  /// A capability query for data destinations that write their bytes to a
+  /// file, and can copy bytes from another file without them passing through
+  /// user memory (see the DataSource class's GetFileDescriptor() function).
+  /// @return Whether the TransferFromFile() function is supported.
+  virtual bool CanTransferFromFile() const { return false; }
+
+  /// This function may be called instead of the Transfer() function if the
+  /// CanTransferFromFile() function returns true. It transfers the bytes in the
+  /// range of the file without changing the file's position. If the file ends
+  /// before the end of the range, the bytes up to the end of the file are
+  /// transferred. The number of bytes transferred is added to the value
+  /// returned by the GetBytesTransferred() function.
+  /// @param fd The file descriptor of the file from which to transfer bytes.
+  /// @param transfer_range The range of the bytes in the file to transfer.
+  /// @return A transfer status value indicating what should be done next.
+  virtual TransferStatus TransferFromFile(int fd,
+                                          const DataRange& transfer_range) {
+    return kTransferError;
+  }
 };
 
 }  // namespace image_io
@@ -59,6 +59,21 @@ class DataScanner {
   /// @return The set of whitespace characters: " \t\n\r".
   static std::string GetWhitespaceChars();
 
+  /// @param value The character to test.
+  /// @return Whether the value can be the first character of a name.
+  static bool IsFirstNameChar(char value);
+
+  /// @param s The characters to scan.
+  /// @param slen The number of characters to scan.
+  /// @return The number of leading characters of s that can follow the first
+  /// character of a name.
+  static size_t SpanNameChars(const char* s, size_t slen);
+
+  /// @param s The characters to scan.
+  /// @param slen The number of characters to scan.
+  /// @return The number of leading whitespace characters of s.
+  static size_t SpanWhitespaceChars(const char* s, size_t slen);
+
   /// @param literal The literal to use for the scanner.
   /// @return A kLiteral type scanner.
   static DataScanner CreateLiteralScanner(const std::string& literal);
@@ -18,7 +18,7 @@ class DataRange;
 /// managed by instances of DataSource which offers them up to client code.
 /// A shared_ptr is used to control the lifetime of DataSegments. For more
 /// information on this, see the comments in DataSource.
-class DataSegment {
+class DataSegment : public std::enable_shared_from_this<DataSegment> {
  public:
   /// A creation parameter for indicating whether or not, upon destruction, the
   /// DataSegment's buffer should be deallocated.
@@ -51,6 +51,63 @@ class DataSegment {
     return Create(data_range, buffer, BufferDispositionPolicy::kDelete);
   }
 
+  /// Creates a new DataSegment with the given DataRange and a byte buffer whose
+  /// memory is managed by another object, such as a block of memory of a
+  /// SegmentAllocator. The data segment shares the ownership of that object,
+  /// so the buffer stays valid for as long as the data segment exists.
+  /// @param data_range The DataRange of the byte data in the buffer.
+  /// @param buffer The byte data of the data segment.
+  /// @param buffer_owner The object that manages the buffer's memory.
+  /// @return A shared pointer to the data segment.
+  static std::shared_ptr<DataSegment> Create(
+      const DataRange& data_range, const Byte* buffer,
+      std::shared_ptr<const void> buffer_owner);
+
+  /// Creates a new DataSegment with the given DataRange and a new buffer of the
+  /// range's length, for the caller to fill. The shared pointer's control
+  /// block, the DataSegment and its buffer are allocated together in a single
+  /// block of memory, instead of the three allocations needed when the buffer
+  /// is allocated separately and passed to the Create() function. The memory
+  /// is released when the last shared pointer to the segment is.
+  /// @param data_range The DataRange of the data segment.
+  /// @param buffer Receives the pointer to the uninitialized buffer.
+  /// @return A shared pointer to the data segment.
+  static std::shared_ptr<DataSegment> CreateWithBuffer(
+      const DataRange& data_range, Byte** buffer);
+
+  /// Creates a new DataSegment that refers to a portion of the bytes of
+  /// another (parent) one, without copying them. The view shares the ownership
+  /// of the parent, so the parent's buffer stays allocated for as long as the
+  /// view exists, regardless of what happens to the other shared pointers to
+  /// the parent. (If the parent does not own its buffer, the view is only
+  /// valid for as long as the parent's buffer is - see OwnsBuffer()).
+  /// @param parent The data segment holding the bytes of the view.
+  /// @param sub_range The range of the view, which must be contained by the
+  ///     parent's range.
+  /// @return A shared pointer to the view, or nullptr if the parent is null or
+  ///     does not contain the sub_range.
+  static std::shared_ptr<DataSegment> CreateView(
+      const std::shared_ptr<const DataSegment>& parent,
+      const DataRange& sub_range);
+
+  /// Points a data segment that does not own its buffer (see OwnsBuffer()) at
+  /// another range and buffer, so that the creator of a series of such short
+  /// lived segments can reuse a single one instead of creating one for each
+  /// buffer. Like the buffer, the segment must not be kept by those it is
+  /// passed to.
+  /// @param data_range The new DataRange of the data segment.
+  /// @param buffer The new byte data of the data segment.
+  /// @return Whether the segment was changed, which it is not if it owns its
+  ///     buffer.
+  bool SetBuffer(const DataRange& data_range, const Byte* buffer) {
+    if (OwnsBuffer()) {
+      return false;
+    }
+    data_range_ = data_range;
+    buffer_ = buffer;
+    return true;
+  }
+
   /// @return The DataRange of the data in the segment.
   const DataRange& GetDataRange() const { return data_range_; }
 
@@ -63,6 +120,22 @@ class DataSegment {
   /// @return The length of the segment's data range.
   size_t GetLength() const { return data_range_.GetLength(); }
 
+  /// @return Whether the segment owns its buffer (i.e., was created with the
+  ///     kDelete policy, a buffer owner or by the CreateWithBuffer() function,
+  ///     or is a view of a segment that owns its buffer). The bytes of
+  ///     such a segment stay valid for as long as a shared pointer to it is
+  ///     held, which is not necessarily the case for a kDontDelete segment,
+  ///     the buffer of which may be reused by its creator once the segment has
+  ///     been passed on.
+  bool OwnsBuffer() const {
+    return buffer_policy_ == BufferDispositionPolicy::kDelete || owns_buffer_;
+  }
+
+  /// @return Whether the segment's buffer is kept alive by another object (it
+  ///     is a view, or was created with a buffer owner), in which case the
+  ///     segment may keep much more memory allocated than its own bytes.
+  bool HasBufferOwner() const { return buffer_owner_ != nullptr; }
+
   /// @return Whether the segment's range is valid.
   bool Contains(size_t location) const {
     return data_range_.Contains(location);
@@ -149,11 +222,16 @@ class DataSegment {
                      const DataSegment* segment1, const DataSegment* segment2);
 
  private:
+  /// The DataSegment subclass created by CreateWithBuffer(), with the buffer
+  /// that follows it in memory.
+  class InlineBufferDataSegment;
+
   DataSegment(const DataRange& data_range, const Byte* buffer,
               BufferDispositionPolicy buffer_policy)
       : data_range_(data_range),
         buffer_(buffer),
-        buffer_policy_(buffer_policy) {}
+        buffer_policy_(buffer_policy),
+        owns_buffer_(false) {}
 
   ~DataSegment() {
     // If kDelete is not set (default) the buffer memory will remain allocated.
@@ -175,6 +253,15 @@ class DataSegment {
 
   /// The policy that dictates whether or not the buffer will be deallocated.
   BufferDispositionPolicy buffer_policy_;
+
+  /// Whether the buffer's memory is owned by the segment without the kDelete
+  /// policy: it was allocated with the segment, or is kept alive by the
+  /// buffer_owner_.
+  bool owns_buffer_;
+
+  /// The object that manages the buffer's memory, if any. For a view, it is
+  /// the parent segment.
+  std::shared_ptr<const void> buffer_owner_;
 };
 
 }  // namespace image_io
@@ -96,6 +96,15 @@ class DataSource {
   virtual TransferDataResult TransferData(
       const DataRange& data_range, size_t best_size,
       DataDestination* data_destination) = 0;
+
+  /// A capability query for data sources that read their bytes directly from
+  /// a file, at offsets that match the locations of their data ranges. Such a
+  /// data source can implement its TransferData() function by asking a data
+  /// destination that writes to a file (see the DataDestination class's
+  /// CanTransferFromFile() function) to copy the bytes between the files in the
+  /// kernel, without bringing them into user memory.
+  /// @return The file descriptor of the data source, or -1 if it has none.
+  virtual int GetFileDescriptor() const { return -1; }
 };
 
 }  // namespace image_io
@@ -0,0 +1,157 @@
+#ifndef IMAGE_IO_BASE_FD_DATA_DESTINATION_H_  // NOLINT
+#define IMAGE_IO_BASE_FD_DATA_DESTINATION_H_  // NOLINT
+
+#include <sys/uio.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "image_io/base/data_destination.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/message_handler.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// A DataDestination that writes to a file descriptor with writev(2). Rather
+/// than writing each transferred range as it comes, the destination queues the
+/// ranges and writes them with a single writev(2) call once the queued bytes or
+/// ranges reach a threshold, or when the transfer is finished. Small ranges
+/// are copied to an internal buffer; larger ones are queued in place, and their
+/// data segments kept alive by shared pointers if they own their buffers.
+/// The ranges of data segments that don't own their buffers, and so may be
+/// reused as soon as the Transfer() function returns, are written right away,
+/// along with the queued ones. Assembling a file from many pieces, such as an
+/// Apple depth file built by JpegAppleDepthBuilder, thus takes a few system
+/// calls rather than one write per piece. The destination also supports the
+/// TransferFromFile() function, so the bytes of a file-backed DataSource like
+/// FdDataSource are copied with copy_file_range(2) or sendfile(2), without
+/// passing through user memory (and are nearly free on file systems that can
+/// share the blocks of the two files).
+class FdDataDestination : public DataDestination {
+ public:
+  /// The default number of queued bytes that causes them to be written.
+  static constexpr size_t kDefaultFlushByteThreshold = 0x100000;
+
+  /// The default number of queued ranges that causes them to be written.
+  static constexpr size_t kDefaultFlushRangeThreshold = 64;
+
+  /// Ranges up to this size are copied to the internal buffer.
+  static constexpr size_t kMaxCopySize = 0x1000;
+
+  /// @param fd The file descriptor to write to. The destination does not take
+  ///     ownership of the descriptor; the caller must keep it open for the
+  ///     lifetime of the destination, and close it afterwards.
+  /// @param message_handler An optional message handler to write messages to.
+  FdDataDestination(int fd, MessageHandler* message_handler)
+      : FdDataDestination(fd, kDefaultFlushByteThreshold,
+                          kDefaultFlushRangeThreshold, message_handler) {}
+
+  /// @param fd The file descriptor to write to (see above).
+  /// @param flush_byte_threshold The number of queued bytes that causes them
+  ///     to be written.
+  /// @param flush_range_threshold The number of queued ranges that causes them
+  ///     to be written.
+  /// @param message_handler An optional message handler to write messages to.
+  FdDataDestination(int fd, size_t flush_byte_threshold,
+                    size_t flush_range_threshold,
+                    MessageHandler* message_handler);
+
+  /// Writes the bytes that are still queued, if any.
+  ~FdDataDestination() override;
+
+  /// @param name A name to use in error messages.
+  void SetName(const std::string& name) { name_ = name; }
+
+  /// @return The name used in error messages.
+  const std::string& GetName() const { return name_; }
+
+  /// @return Whether there was an error writing to the file descriptor.
+  bool HasError() const { return has_error_; }
+
+  /// @return The number of system calls made so far to write bytes to the
+  ///     file descriptor.
+  size_t GetWriteCallCount() const { return write_call_count_; }
+
+  void StartTransfer() override;
+  TransferStatus Transfer(const DataRange& transfer_range,
+                          const DataSegment& data_segment) override;
+  void FinishTransfer() override;
+  bool CanTransferFromFile() const override { return true; }
+  TransferStatus TransferFromFile(int fd,
+                                  const DataRange& transfer_range) override;
+
+  /// @return The number of bytes accepted by the Transfer() function, some of
+  ///     which may still be queued until the FinishTransfer() function is
+  ///     called.
+  size_t GetBytesTransferred() const override { return bytes_transferred_; }
+
+ private:
+  /// The ways of copying bytes from a file, from the most to least efficient.
+  /// The TransferFromFile() function falls back to the next one as soon as a
+  /// system call reports that the files do not support the current one.
+  enum FileCopyMethod { kCopyFileRange, kSendFile, kReadWrite };
+
+  /// Copies bytes from a file to the file descriptor.
+  /// @param fd The file descriptor of the file from which to copy bytes.
+  /// @param begin The location in the file of the first byte to copy.
+  /// @param count The maximum number of bytes to copy.
+  /// @return The number of bytes copied, 0 if the file has no bytes at the
+  ///     begin location, or -1 if there was an error, in which case errno
+  ///     is set by the failed system call.
+  ssize_t CopyFromFile(int fd, size_t begin, size_t count);
+
+  /// Adds a range of bytes to the queue, merging it with the last one if they
+  /// are adjacent in memory.
+  /// @param bytes The bytes of the range.
+  /// @param size The number of bytes in the range.
+  void Enqueue(const Byte* bytes, size_t size);
+
+  /// Writes the queued bytes and empties the queue.
+  /// @return Whether the bytes were written successfully.
+  bool Flush();
+
+  /// The file descriptor to write to.
+  int fd_;
+
+  /// The thresholds that cause the queued bytes to be written.
+  size_t flush_byte_threshold_;
+  size_t flush_range_threshold_;
+
+  /// An optional message handler to write messages to.
+  MessageHandler* message_handler_;
+
+  /// The queued ranges of bytes.
+  std::vector<iovec> queued_ranges_;
+
+  /// The number of queued bytes.
+  size_t queued_byte_count_;
+
+  /// The data segments whose bytes are referenced by the queued ranges.
+  std::vector<std::shared_ptr<const DataSegment>> queued_data_segments_;
+
+  /// The buffer holding the copies of the small ranges, and its used size.
+  std::unique_ptr<Byte[]> copy_buffer_;
+  size_t copy_buffer_size_;
+
+  /// The number of bytes accepted by the Transfer() function.
+  size_t bytes_transferred_;
+
+  /// The number of system calls made to write bytes.
+  size_t write_call_count_;
+
+  /// The method used by the TransferFromFile() function.
+  FileCopyMethod file_copy_method_;
+
+  /// The name used in error messages.
+  std::string name_;
+
+  /// Whether there was an error writing to the file descriptor.
+  bool has_error_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_FD_DATA_DESTINATION_H_  // NOLINT
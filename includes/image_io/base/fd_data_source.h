@@ -0,0 +1,95 @@
+#ifndef IMAGE_IO_BASE_FD_DATA_SOURCE_H_  // NOLINT
+#define IMAGE_IO_BASE_FD_DATA_SOURCE_H_  // NOLINT
+
+#include <memory>
+#include <string>
+
+#include "image_io/base/data_source.h"
+#include "image_io/base/message_handler.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// A DataSource that obtains data from a file descriptor using pread(2). The
+/// data source keeps no file position, so a single open file descriptor can be
+/// shared by several FdDataSource instances, possibly on different threads. The
+/// buffers of the DataSegments it returns are recycled through a small pool
+/// once the last reference to each segment is released, so repeated reads of
+/// similarly sized windows do not allocate new buffers. If the data destination
+/// of a TransferData() call writes to a file too, the bytes are copied from one
+/// file to the other in the kernel, and no DataSegments are created at all.
+/// Read errors are reported to the message handler, if there is one, so that
+/// they can be told apart from the end of the file.
+class FdDataSource : public DataSource {
+ public:
+  /// The default maximum number of buffers kept in the pool for reuse.
+  static constexpr size_t kDefaultMaxPooledBufferCount = 4;
+
+  /// Constructs an FdDataSource using the given file descriptor.
+  /// @param fd The file descriptor from which to read. The data source does not
+  ///     take ownership of the descriptor; the caller must keep it open for the
+  ///     lifetime of the data source, and close it afterwards.
+  /// @param message_handler An optional message handler to write messages to.
+  FdDataSource(int fd, MessageHandler* message_handler)
+      : FdDataSource(fd, kDefaultMaxPooledBufferCount, message_handler) {}
+
+  /// Constructs an FdDataSource using the given file descriptor.
+  /// @param fd The file descriptor from which to read (see above).
+  /// @param max_pooled_buffer_count The maximum number of released buffers to
+  ///     keep in the pool for reuse.
+  /// @param message_handler An optional message handler to write messages to.
+  FdDataSource(int fd, size_t max_pooled_buffer_count,
+               MessageHandler* message_handler);
+  FdDataSource(const FdDataSource&) = delete;
+  FdDataSource& operator=(const FdDataSource&) = delete;
+
+  /// Changes the file descriptor from which the data source reads. The pooled
+  /// buffers are kept, so a single data source can read a series of files
+  /// without allocating new buffers for each one.
+  /// @param fd The file descriptor from which to read (see above).
+  void SetFileDescriptor(int fd) { fd_ = fd; }
+
+  /// @param name A name to use in error messages.
+  void SetName(const std::string& name) { name_ = name; }
+
+  /// @return The name used in error messages.
+  const std::string& GetName() const { return name_; }
+
+  void Reset() override;
+  std::shared_ptr<DataSegment> GetDataSegment(size_t begin,
+                                              size_t min_size) override;
+  TransferDataResult TransferData(const DataRange& data_range, size_t best_size,
+                                  DataDestination* data_destination) override;
+  int GetFileDescriptor() const override { return fd_; }
+
+ private:
+  class BufferPool;
+
+  /// The worker function to create a DataSegment and fill it with the given
+  /// number of bytes read from the file descriptor, starting at the given
+  /// location.
+  /// @param begin The location in the file at which to start reading.
+  /// @param count The number of bytes to read.
+  /// @return A DataSegment pointer, or nullptr if the read failed (which is
+  ///     reported to the message handler) or there were no bytes at the given
+  ///     location.
+  std::shared_ptr<DataSegment> Read(size_t begin, size_t count);
+
+  /// The file descriptor from which to read.
+  int fd_;
+
+  /// The name used in error messages.
+  std::string name_;
+
+  /// An optional message handler to write messages to.
+  MessageHandler* message_handler_;
+
+  /// The pool of buffers, shared with the DataSegments that are still in use
+  /// so that their buffers can be returned even if this data source is gone.
+  std::shared_ptr<BufferPool> buffer_pool_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_FD_DATA_SOURCE_H_  // NOLINT
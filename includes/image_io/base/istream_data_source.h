@@ -17,6 +17,15 @@ class IStreamDataSource : public IStreamRefDataSource {
   explicit IStreamDataSource(std::unique_ptr<std::istream> istream_ptr)
       : IStreamRefDataSource(*istream_ptr), istream_(std::move(istream_ptr)) {}
 
+  /// Constructs an IStreamDataSource using the given istream, that creates
+  /// the data segments it reads with the given allocator.
+  /// @param istram_ptr The istream from which to read.
+  /// @param segment_allocator The allocator of the data segments, or nullptr.
+  IStreamDataSource(std::unique_ptr<std::istream> istream_ptr,
+                    SegmentAllocator* segment_allocator)
+      : IStreamRefDataSource(*istream_ptr, segment_allocator),
+        istream_(std::move(istream_ptr)) {}
+
  private:
   /// The istream that is owned by this data source.
   std::unique_ptr<std::istream> istream_;
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "image_io/base/data_source.h"
+#include "image_io/base/segment_allocator.h"
 
 namespace photos_editing_formats {
 namespace image_io {
@@ -14,7 +15,17 @@ class IStreamRefDataSource : public DataSource {
   /// Constructs an IStreamDataSource using the given istream.
   /// @param istream_ref The istream from which to read.
   explicit IStreamRefDataSource(std::istream& istream_ref)
-      : istream_ref_(istream_ref) {}
+      : IStreamRefDataSource(istream_ref, nullptr) {}
+
+  /// Constructs an IStreamDataSource using the given istream, that creates
+  /// the data segments it reads with the given allocator.
+  /// @param istream_ref The istream from which to read.
+  /// @param segment_allocator The allocator of the data segments, or nullptr
+  ///     to create them with the DataSegment::CreateWithBuffer() function. The
+  ///     allocator must outlive the data source.
+  IStreamRefDataSource(std::istream& istream_ref,
+                       SegmentAllocator* segment_allocator)
+      : istream_ref_(istream_ref), segment_allocator_(segment_allocator) {}
   IStreamRefDataSource(const IStreamRefDataSource&) = delete;
   IStreamRefDataSource& operator=(const IStreamRefDataSource&) = delete;
 
@@ -36,6 +47,9 @@ class IStreamRefDataSource : public DataSource {
   /// The istream from which to read.
   std::istream& istream_ref_;
 
+  /// The optional allocator of the data segments.
+  SegmentAllocator* segment_allocator_;
+
   /// The current data segment that was read in the GetDataSegment() function.
   std::shared_ptr<DataSegment> current_data_segment_;
 };
@@ -0,0 +1,57 @@
+#ifndef IMAGE_IO_BASE_MMAP_DATA_SOURCE_H_  // NOLINT
+#define IMAGE_IO_BASE_MMAP_DATA_SOURCE_H_  // NOLINT
+
+#include <memory>
+#include <string>
+
+#include "image_io/base/data_segment_data_source.h"
+#include "image_io/base/data_source.h"
+#include "image_io/base/message_handler.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// A DataSource that maps a file into memory once and then hands out a single
+/// DataSegment that covers the entire file. The DataSegment is created with the
+/// kDontDelete policy and points directly into the mapping, so no bytes are
+/// copied and no buffers are allocated as the data is scanned or transferred.
+/// Because the DataSegments refer to the mapped memory, they must not be used
+/// after the MmapDataSource that produced them has been destroyed.
+class MmapDataSource : public DataSource {
+ public:
+  /// Constructs an MmapDataSource by mapping the contents of the named file.
+  /// @param file_name The name of the file to map.
+  /// @param message_handler An optional message handler for writing messages.
+  MmapDataSource(const std::string& file_name, MessageHandler* message_handler);
+  MmapDataSource(const MmapDataSource&) = delete;
+  MmapDataSource& operator=(const MmapDataSource&) = delete;
+  ~MmapDataSource() override;
+
+  /// @return Whether the file was successfully mapped. An empty file can not
+  ///     be mapped, so this function returns false in that case too.
+  bool IsValid() const { return data_source_ != nullptr; }
+
+  /// @return The size of the mapped file, or 0 if the mapping failed.
+  size_t GetSize() const { return mapped_size_; }
+
+  void Reset() override;
+  std::shared_ptr<DataSegment> GetDataSegment(size_t begin,
+                                              size_t min_size) override;
+  TransferDataResult TransferData(const DataRange& data_range, size_t best_size,
+                                  DataDestination* data_destination) override;
+
+ private:
+  /// The start of the mapped memory, or nullptr if the mapping failed.
+  void* mapped_address_;
+
+  /// The number of bytes that are mapped.
+  size_t mapped_size_;
+
+  /// The data source that wraps the DataSegment referring to the mapping.
+  std::unique_ptr<DataSegmentDataSource> data_source_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_MMAP_DATA_SOURCE_H_  // NOLINT
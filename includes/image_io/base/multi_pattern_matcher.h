@@ -0,0 +1,98 @@
+#ifndef IMAGE_IO_BASE_MULTI_PATTERN_MATCHER_H_  // NOLINT
+#define IMAGE_IO_BASE_MULTI_PATTERN_MATCHER_H_  // NOLINT
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "image_io/base/types.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// MultiPatternMatcher finds all occurrences of a set of byte string patterns
+/// in a single pass over the bytes, using the Aho-Corasick algorithm: the
+/// patterns are compiled into a trie whose nodes have failure links to the
+/// node of their longest proper suffix, so that each byte is looked at once,
+/// no matter how many patterns there are. The scan can be done in pieces, by
+/// passing the state returned by one call of the Scan() function to the next.
+class MultiPatternMatcher {
+ public:
+  /// The state at the start of a scan.
+  static constexpr uint32_t kStartState = 0;
+
+  MultiPatternMatcher();
+
+  /// Adds a pattern to the matcher, and recompiles it.
+  /// @param pattern The non-empty pattern to add.
+  /// @return The index of the pattern, which is the index of the previously
+  ///     added pattern if they are the same.
+  size_t AddPattern(const std::string& pattern);
+
+  /// @return The number of patterns in the matcher.
+  size_t GetPatternCount() const { return patterns_.size(); }
+
+  /// @param index The index of a pattern.
+  /// @return The pattern with the index.
+  const std::string& GetPattern(size_t index) const { return patterns_[index]; }
+
+  /// Scans the bytes for the patterns.
+  /// @param state The state to start in, either kStartState or the value
+  ///     returned by the previous call for the preceding bytes.
+  /// @param bytes The bytes to scan.
+  /// @param byte_count The number of bytes to scan.
+  /// @param matches The vector in which to set the element with the index of
+  ///     each pattern that is found to true. It is resized to the number of
+  ///     patterns if it is smaller than that.
+  /// @return The state to pass to the call for the bytes that follow.
+  uint32_t Scan(uint32_t state, const Byte* bytes, size_t byte_count,
+                std::vector<bool>* matches) const;
+
+ private:
+  /// The value of the node and pattern indices that indicates there is none.
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  /// A node of the trie.
+  struct Node {
+    Node() : failure(kStartState), output(kNone), pattern_index(kNone) {}
+
+    /// The bytes and indices of the child nodes, in the order added.
+    std::vector<std::pair<Byte, uint32_t>> children;
+
+    /// The index of the node of the longest proper suffix of this node's
+    /// string that is also a prefix of a pattern.
+    uint32_t failure;
+
+    /// The index of the nearest node in the chain of failure links that ends
+    /// a pattern, or kNone.
+    uint32_t output;
+
+    /// The index of the pattern that ends at this node, or kNone.
+    uint32_t pattern_index;
+  };
+
+  /// @param node_index The index of a node.
+  /// @param value The byte value of the child to look for.
+  /// @return The index of the child, or kNone if the node has no such child.
+  uint32_t GetChild(uint32_t node_index, Byte value) const;
+
+  /// Computes the failure and output links of the nodes, and the transitions
+  /// from the root node.
+  void Compile();
+
+  /// The patterns, in the order they were added.
+  std::vector<std::string> patterns_;
+
+  /// The nodes of the trie. The first one is the root.
+  std::vector<Node> nodes_;
+
+  /// The index of the next node from the root for each byte value, which is
+  /// the root itself for the values that do not start any pattern.
+  std::vector<uint32_t> root_transitions_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_MULTI_PATTERN_MATCHER_H_  // NOLINT
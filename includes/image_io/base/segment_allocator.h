@@ -0,0 +1,97 @@
+#ifndef IMAGE_IO_BASE_SEGMENT_ALLOCATOR_H_  // NOLINT
+#define IMAGE_IO_BASE_SEGMENT_ALLOCATOR_H_  // NOLINT
+
+#include <memory>
+#include <mutex>  // NOLINT
+
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/types.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// SegmentAllocator is the abstract base class of the objects that data
+/// sources and data destinations can be given to create the DataSegments (and
+/// their buffers) that they fill with bytes. Without one, such segments are
+/// created with the DataSegment::CreateWithBuffer() function.
+class SegmentAllocator {
+ public:
+  virtual ~SegmentAllocator() = default;
+
+  /// Creates a data segment that owns its buffer (see the OwnsBuffer()
+  /// function of DataSegment), for the caller to fill.
+  /// @param data_range The data range of the segment.
+  /// @param buffer Receives the pointer to the uninitialized buffer.
+  /// @return A shared pointer to the data segment.
+  virtual std::shared_ptr<DataSegment> Allocate(const DataRange& data_range,
+                                                Byte** buffer) = 0;
+
+  /// Creates a data segment with the given allocator, or with the
+  /// DataSegment::CreateWithBuffer() function if there is none.
+  /// @param allocator The allocator to use, or nullptr.
+  /// @param data_range The data range of the segment.
+  /// @param buffer Receives the pointer to the uninitialized buffer.
+  /// @return A shared pointer to the data segment.
+  static std::shared_ptr<DataSegment> CreateDataSegment(
+      SegmentAllocator* allocator, const DataRange& data_range,
+      Byte** buffer) {
+    return allocator ? allocator->Allocate(data_range, buffer)
+                     : DataSegment::CreateWithBuffer(data_range, buffer);
+  }
+};
+
+/// A SegmentAllocator that carves the buffers of the segments out of fixed
+/// size blocks of memory, arena style, by bumping an offset in the current
+/// block. A block is put on a free list for reuse once all the segments that
+/// were allocated from it have been released, so a scan that reads its data
+/// in pieces of up to the block size allocates a few blocks at the start and
+/// then none at all. Larger segments are created with CreateWithBuffer().
+/// The allocator can be used from several threads, but is best given to each
+/// worker thread of a batch, so that the threads do not compete for memory.
+/// The segments may outlive the allocator.
+class BlockSegmentAllocator : public SegmentAllocator {
+ public:
+  /// The size of the blocks of memory.
+  static constexpr size_t kBlockSize = 0x10000;
+
+  /// The default maximum number of free blocks kept for reuse.
+  static constexpr size_t kDefaultMaxFreeBlockCount = 8;
+
+  BlockSegmentAllocator() : BlockSegmentAllocator(kDefaultMaxFreeBlockCount) {}
+
+  /// @param max_free_block_count The maximum number of free blocks to keep for
+  ///     reuse; any others are deleted when their segments are released.
+  explicit BlockSegmentAllocator(size_t max_free_block_count);
+  BlockSegmentAllocator(const BlockSegmentAllocator&) = delete;
+  BlockSegmentAllocator& operator=(const BlockSegmentAllocator&) = delete;
+
+  std::shared_ptr<DataSegment> Allocate(const DataRange& data_range,
+                                        Byte** buffer) override;
+
+  /// @return The number of blocks allocated from the heap so far.
+  size_t GetNewBlockCount() const;
+
+ private:
+  class BlockPool;
+
+  /// The mutex that guards the current block and its offset.
+  mutable std::mutex mutex_;
+
+  /// The pool of free blocks, shared with the blocks that are in use so that
+  /// they can be returned even if this allocator is gone.
+  std::shared_ptr<BlockPool> block_pool_;
+
+  /// The block from which segments are currently allocated, whose last
+  /// reference is released (and the block returned to the pool) by the
+  /// segments allocated from it.
+  std::shared_ptr<Byte> current_block_;
+
+  /// The offset of the unused part of the current block.
+  size_t current_block_offset_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_SEGMENT_ALLOCATOR_H_  // NOLINT
@@ -0,0 +1,537 @@
+#ifndef IMAGE_IO_BASE_STATIC_DATA_SCANNER_H_  // NOLINT
+#define IMAGE_IO_BASE_STATIC_DATA_SCANNER_H_  // NOLINT
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <tuple>
+
+#include "image_io/base/data_context.h"
+#include "image_io/base/data_match_result.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_scanner.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// The static scanners are compile time counterparts of the DataScanner types.
+/// Their type, and their literal or sentinels, are template parameters rather
+/// than data members, so each Scan() call compiles to the code of that one type
+/// of scanner, with the literal's length and the sentinels as constants. They
+/// follow the same Scan() contract as the DataScanner (and report the same
+/// errors), and can be combined into a static grammar with ScannerSequence.
+/// The DataScanner remains the choice when the scanners are chosen at run time.
+/// Since C++17 does not allow string literals as template arguments, a literal
+/// is given as a constexpr char array with static storage, for example:
+///   constexpr char kRdfDescription[] = "rdf:Description";
+///   LiteralScanner<kRdfDescription> scanner;
+
+/// StaticDataScanner is the base class of the static scanners, using the CRTP
+/// to call the Derived class's ScanBytes() function without a virtual call.
+/// The derived class provides the functions:
+///   DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+///                             const DataContext& context);
+///   void ResetState();
+///   std::string GetDescription() const;
+template <typename Derived>
+class StaticDataScanner {
+ public:
+  /// @param context The data context to use for the scan operation.
+  /// @return The match result of the scan operation.
+  DataMatchResult Scan(const DataContext& context) {
+    if (!context.IsValidLocationAndRange()) {
+      DataMatchResult result;
+      SetInternalError(context, context.GetInvalidLocationAndRangeErrorText(),
+                       &result);
+      return result;
+    }
+    if (!token_range_.IsValid()) {
+      token_range_ = DataRange(context.GetLocation(), context.GetLocation());
+    }
+    size_t bytes_available =
+        context.GetRange().GetEnd() - context.GetLocation();
+    return static_cast<Derived*>(this)->ScanBytes(context.GetCharBytes(),
+                                                  bytes_available, context);
+  }
+
+  /// @return The range of characters that the scanner found during one or more
+  /// successful Scan() function operations.
+  const DataRange& GetTokenRange() const { return token_range_; }
+
+  /// Reset the scanner's token range to an invalid value.
+  void ResetTokenRange() { token_range_ = DataRange(); }
+
+  /// Reset the scanner state to the value it had when it was first constructed.
+  void Reset() {
+    ResetTokenRange();
+    static_cast<Derived*>(this)->ResetState();
+  }
+
+ protected:
+  /// @return The length of the token range.
+  size_t GetTokenLength() const { return token_range_.GetLength(); }
+
+  /// @param delta_length The byte count to use to extend the token range end.
+  /// @return The new length of the token range.
+  size_t ExtendTokenLength(size_t delta_length) {
+    token_range_ = DataRange(token_range_.GetBegin(),
+                             token_range_.GetEnd() + delta_length);
+    return token_range_.GetLength();
+  }
+
+  /// Sets the match result to kError and generates an internal error message.
+  /// @param context The data context for message generation purposes.
+  /// @param error_description A description of the type of internal error.
+  /// @param result The result to receive the kError type and message.
+  void SetInternalError(const DataContext& context,
+                        const std::string& error_description,
+                        DataMatchResult* result) const {
+    result->SetType(DataMatchResult::kError);
+    result->SetMessage(
+        Message::kInternalError,
+        context.GetErrorText({}, {GetDerivedDescription()}, error_description,
+                             ""));
+  }
+
+  /// Sets the match result to kError and generates an syntax error message.
+  /// @param context The data context for message generation purposes.
+  /// @param error_description A description of the type of syntax error.
+  /// @param result The result to receive the kError type and message.
+  void SetSyntaxError(const DataContext& context,
+                      const std::string& error_description,
+                      DataMatchResult* result) const {
+    result->SetType(DataMatchResult::kError);
+    result->SetMessage(
+        Message::kSyntaxError,
+        context.GetErrorText(error_description, GetDerivedDescription()));
+  }
+
+ private:
+  std::string GetDerivedDescription() const {
+    return static_cast<const Derived*>(this)->GetDescription();
+  }
+
+  /// The token range built by one or calls to the Scan() function.
+  DataRange token_range_;
+};
+
+/// The static counterpart of the DataScanner::kLiteral type scanner.
+template <const char* kLiteral>
+class LiteralScanner : public StaticDataScanner<LiteralScanner<kLiteral>> {
+ public:
+  /// The length of the literal.
+  static constexpr size_t kLiteralLength =
+      std::char_traits<char>::length(kLiteral);
+  static_assert(kLiteralLength > 0, "The literal must not be empty");
+
+  /// @return The literal value of the scanner.
+  static constexpr const char* GetLiteral() { return kLiteral; }
+
+  std::string GetDescription() const {
+    return std::string("Literal:'") + kLiteral + "'";
+  }
+
+ private:
+  friend class StaticDataScanner<LiteralScanner>;
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    size_t token_length = this->GetTokenLength();
+    if (token_length >= kLiteralLength) {
+      this->SetInternalError(context, "Literal already scanned", &result);
+      return result;
+    }
+    size_t bytes_still_needed = kLiteralLength - token_length;
+    size_t bytes_to_compare = std::min(bytes_still_needed, bytes_available);
+    if (std::memcmp(kLiteral + token_length, cbytes, bytes_to_compare) == 0) {
+      token_length = this->ExtendTokenLength(bytes_to_compare);
+      result.SetBytesConsumed(bytes_to_compare);
+      result.SetType(token_length == kLiteralLength
+                         ? DataMatchResult::kFull
+                         : DataMatchResult::kPartialOutOfData);
+    } else {
+      this->SetSyntaxError(context, "Expected literal", &result);
+    }
+    return result;
+  }
+
+  void ResetState() {}
+};
+
+/// The static counterpart of the DataScanner::kThroughLiteral type scanner.
+template <const char* kLiteral>
+class ThroughLiteralScanner
+    : public StaticDataScanner<ThroughLiteralScanner<kLiteral>> {
+ public:
+  /// The length of the literal.
+  static constexpr size_t kLiteralLength =
+      std::char_traits<char>::length(kLiteral);
+  static_assert(kLiteralLength > 0, "The literal must not be empty");
+
+  ThroughLiteralScanner() : scanned_literal_length_(0) {}
+
+  /// @return The literal value of the scanner.
+  static constexpr const char* GetLiteral() { return kLiteral; }
+
+  std::string GetDescription() const {
+    return std::string("ThruLiteral:'") + kLiteral + "'";
+  }
+
+ private:
+  friend class StaticDataScanner<ThroughLiteralScanner>;
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    if (scanned_literal_length_ >= kLiteralLength) {
+      this->SetInternalError(context, "Literal already scanned", &result);
+      return result;
+    }
+    while (bytes_available > 0) {
+      if (scanned_literal_length_ == 0) {
+        // Literal scan not in progress. Find the first char of the literal.
+        auto* matched_byte = reinterpret_cast<const char*>(
+            std::memchr(cbytes, kLiteral[0], bytes_available));
+        if (matched_byte == nullptr) {
+          this->ExtendTokenLength(bytes_available);
+          result.IncrementBytesConsumed(bytes_available);
+          result.SetType(DataMatchResult::kPartialOutOfData);
+          break;
+        }
+        size_t bytes_scanned = (matched_byte - cbytes) + 1;
+        result.IncrementBytesConsumed(bytes_scanned);
+        bytes_available -= bytes_scanned;
+        cbytes += bytes_scanned;
+        this->ExtendTokenLength(bytes_scanned);
+        scanned_literal_length_ = 1;
+      }
+      // Check if the rest of the literal is there.
+      size_t bytes_still_needed = kLiteralLength - scanned_literal_length_;
+      size_t bytes_to_compare = std::min(bytes_still_needed, bytes_available);
+      if (std::memcmp(kLiteral + scanned_literal_length_, cbytes,
+                      bytes_to_compare) == 0) {
+        this->ExtendTokenLength(bytes_to_compare);
+        scanned_literal_length_ += bytes_to_compare;
+        result.IncrementBytesConsumed(bytes_to_compare);
+        result.SetType(scanned_literal_length_ == kLiteralLength
+                           ? DataMatchResult::kFull
+                           : DataMatchResult::kPartialOutOfData);
+        break;
+      }
+      // Only the first chars of the literal were found, so keep searching at
+      // one past the first char of the match.
+      scanned_literal_length_ = 0;
+    }
+    return result;
+  }
+
+  void ResetState() { scanned_literal_length_ = 0; }
+
+  /// The number of characters of the literal scanned so far.
+  size_t scanned_literal_length_;
+};
+
+/// The static counterpart of the DataScanner::kSentinel type scanner. As with
+/// the DataScanner, the '~' sentinel matches any of the characters that can
+/// begin a name.
+template <char... kSentinels>
+class SentinelScanner
+    : public StaticDataScanner<SentinelScanner<kSentinels...>> {
+ public:
+  static_assert(sizeof...(kSentinels) > 0, "There must be a sentinel");
+
+  SentinelScanner() : sentinel_(0) {}
+
+  /// @return The set of sentinels of the scanner.
+  static std::string GetSentinels() { return std::string{kSentinels...}; }
+
+  /// @return The sentinel that was matched by a successful scan operation, or
+  /// 0 otherwise.
+  char GetSentinel() const { return sentinel_; }
+
+  std::string GetDescription() const {
+    return "OneOf:'" + GetSentinels() + "'";
+  }
+
+ private:
+  friend class StaticDataScanner<SentinelScanner>;
+
+  /// @param sentinel One of the sentinels.
+  /// @param value The character to test.
+  /// @return Whether the character matches the sentinel.
+  static bool IsMatch(char sentinel, char value) {
+    return sentinel == '~' ? DataScanner::IsFirstNameChar(value)
+                           : value == sentinel;
+  }
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    if (sentinel_ != 0) {
+      this->SetInternalError(context, "Sentinel already scanned", &result);
+      return result;
+    }
+    // The fold expression stops at the first sentinel that matches.
+    char value = *cbytes;
+    char sentinel = 0;
+    static_cast<void>(
+        ((IsMatch(kSentinels, value) && (sentinel = kSentinels, true)) ||
+         ...));
+    if (sentinel != 0) {
+      this->ExtendTokenLength(1);
+      result.SetBytesConsumed(1).SetType(DataMatchResult::kFull);
+      sentinel_ = sentinel;
+    } else {
+      this->SetSyntaxError(context, "Expected sentinal character", &result);
+    }
+    return result;
+  }
+
+  void ResetState() { sentinel_ = 0; }
+
+  /// The sentinel matched by the scan.
+  char sentinel_;
+};
+
+/// The static counterpart of the DataScanner::kName type scanner.
+class NameScanner : public StaticDataScanner<NameScanner> {
+ public:
+  std::string GetDescription() const { return "Name"; }
+
+ private:
+  friend class StaticDataScanner<NameScanner>;
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    size_t token_length = GetTokenLength();
+    if (token_length == 0) {
+      if (!DataScanner::IsFirstNameChar(*cbytes)) {
+        SetSyntaxError(context, "Expected first character of a name", &result);
+        return result;
+      }
+      token_length = ExtendTokenLength(1);
+      result.SetBytesConsumed(1);
+      bytes_available -= 1;
+      cbytes += 1;
+    }
+    size_t optional_bytes_consumed =
+        DataScanner::SpanNameChars(cbytes, bytes_available);
+    token_length = ExtendTokenLength(optional_bytes_consumed);
+    result.IncrementBytesConsumed(optional_bytes_consumed);
+    if (result.GetBytesConsumed() == 0 && token_length > 0) {
+      result.SetType(DataMatchResult::kFull);
+    } else if (optional_bytes_consumed < bytes_available) {
+      result.SetType(DataMatchResult::kFull);
+    } else {
+      result.SetType(DataMatchResult::kPartialOutOfData);
+    }
+    return result;
+  }
+
+  void ResetState() {}
+};
+
+/// The static counterpart of the DataScanner::kQuotedString type scanner.
+class QuotedStringScanner : public StaticDataScanner<QuotedStringScanner> {
+ public:
+  QuotedStringScanner() : quote_mark_(0) {}
+
+  std::string GetDescription() const { return "QuotedString"; }
+
+ private:
+  friend class StaticDataScanner<QuotedStringScanner>;
+
+  /// The value of the quote_mark_ once the closing quote mark is scanned.
+  static constexpr char kDone = '.';
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    size_t token_length = GetTokenLength();
+    if ((quote_mark_ == 0 && token_length != 0) ||
+        (quote_mark_ != 0 && quote_mark_ != '\'' && quote_mark_ != '"')) {
+      SetInternalError(context, "Inconsistent state", &result);
+      return result;
+    }
+    if (quote_mark_ == 0) {
+      if (*cbytes != '\'' && *cbytes != '"') {
+        SetSyntaxError(context, "Expected start of a quoted string", &result);
+        return result;
+      }
+      quote_mark_ = *cbytes++;
+      bytes_available--;
+      result.SetBytesConsumed(1);
+      ExtendTokenLength(1);
+    }
+    const char* ebytes = reinterpret_cast<const char*>(
+        std::memchr(cbytes, quote_mark_, bytes_available));
+    size_t bytes_scanned = ebytes ? ebytes - cbytes : bytes_available;
+    result.IncrementBytesConsumed(bytes_scanned);
+    ExtendTokenLength(bytes_scanned);
+    if (bytes_scanned == bytes_available) {
+      result.SetType(DataMatchResult::kPartialOutOfData);
+    } else {
+      result.SetType(DataMatchResult::kFull);
+      result.IncrementBytesConsumed(1);
+      ExtendTokenLength(1);
+      quote_mark_ = kDone;
+    }
+    return result;
+  }
+
+  void ResetState() { quote_mark_ = 0; }
+
+  /// The opening quote mark, 0 before it is scanned, or kDone.
+  char quote_mark_;
+};
+
+/// The static counterpart of the DataScanner::kWhitespace (if kIsOptional is
+/// false) and kOptionalWhitespace (if true) type scanners.
+template <bool kIsOptional>
+class BasicWhitespaceScanner
+    : public StaticDataScanner<BasicWhitespaceScanner<kIsOptional>> {
+ public:
+  std::string GetDescription() const {
+    return kIsOptional ? "OptionalWhitespace" : "Whitespace";
+  }
+
+ private:
+  friend class StaticDataScanner<BasicWhitespaceScanner>;
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    result.SetBytesConsumed(
+        DataScanner::SpanWhitespaceChars(cbytes, bytes_available));
+    size_t token_length = this->ExtendTokenLength(result.GetBytesConsumed());
+    if (result.GetBytesConsumed() == 0) {
+      if (token_length == 0 && !kIsOptional) {
+        this->SetSyntaxError(context, "Expected whitespace", &result);
+      } else {
+        result.SetType(DataMatchResult::kFull);
+      }
+    } else {
+      result.SetType((result.GetBytesConsumed() < bytes_available)
+                         ? DataMatchResult::kFull
+                         : DataMatchResult::kPartialOutOfData);
+    }
+    return result;
+  }
+
+  void ResetState() {}
+};
+
+using WhitespaceScanner = BasicWhitespaceScanner<false>;
+using OptionalWhitespaceScanner = BasicWhitespaceScanner<true>;
+
+/// A static grammar: a sequence of static scanners that must match one after
+/// the other. Like a single scanner, the sequence may be given its data over
+/// several Scan() calls; a call that runs out of data returns kPartialOutOfData
+/// and the next call resumes with the scanner that was in progress. The Scan()
+/// function returns kFull once the last scanner has a full match, or the first
+/// error result of a scanner, with the total number of bytes consumed by the
+/// call. The scanners of a sequence can themselves be sequences. For example,
+/// an XMP property definition is matched by:
+///   constexpr char kEquals[] = "=";
+///   ScannerSequence<OptionalWhitespaceScanner, NameScanner,
+///                   LiteralScanner<kEquals>, QuotedStringScanner> property;
+template <typename... Scanners>
+class ScannerSequence
+    : public StaticDataScanner<ScannerSequence<Scanners...>> {
+ public:
+  /// The number of scanners in the sequence.
+  static constexpr size_t kScannerCount = sizeof...(Scanners);
+  static_assert(kScannerCount > 0, "The sequence must not be empty");
+
+  ScannerSequence() : scanner_index_(0) {}
+
+  /// @return The scanner at the given index of the sequence, for example to
+  /// obtain its token range after a successful scan.
+  template <size_t kIndex>
+  const typename std::tuple_element<kIndex, std::tuple<Scanners...>>::type&
+  GetScanner() const {
+    return std::get<kIndex>(scanners_);
+  }
+
+  std::string GetDescription() const {
+    std::string description = "Sequence:";
+    AppendDescriptions<0>(&description);
+    return description;
+  }
+
+ private:
+  friend class StaticDataScanner<ScannerSequence>;
+
+  DataMatchResult ScanBytes(const char* cbytes, size_t bytes_available,
+                            const DataContext& context) {
+    DataMatchResult result;
+    if (scanner_index_ >= kScannerCount) {
+      this->SetInternalError(context, "Sequence already scanned", &result);
+      return result;
+    }
+    DataContext scanner_context(context);
+    ScanFrom<0>(&scanner_context, &result);
+    this->ExtendTokenLength(result.GetBytesConsumed());
+    return result;
+  }
+
+  /// Runs the scanner at kIndex if it is the one in progress, and the ones
+  /// that follow it while they have full matches and there is data left.
+  /// @param context The context, whose location is advanced past the bytes
+  ///     consumed by each full match.
+  /// @param result The result of the sequence, updated with that of each
+  ///     scanner that is run.
+  template <size_t kIndex>
+  void ScanFrom(DataContext* context, DataMatchResult* result) {
+    if constexpr (kIndex < kScannerCount) {
+      if (scanner_index_ == kIndex) {
+        DataMatchResult scanner_result =
+            std::get<kIndex>(scanners_).Scan(*context);
+        size_t bytes_consumed =
+            result->GetBytesConsumed() + scanner_result.GetBytesConsumed();
+        *result = scanner_result;
+        result->SetBytesConsumed(bytes_consumed);
+        if (scanner_result.GetType() != DataMatchResult::kFull) {
+          return;
+        }
+        ++scanner_index_;
+        context->IncrementLocation(scanner_result.GetBytesConsumed());
+        if (kIndex + 1 < kScannerCount &&
+            context->GetLocation() >= context->GetRange().GetEnd()) {
+          result->SetType(DataMatchResult::kPartialOutOfData);
+          return;
+        }
+      }
+      ScanFrom<kIndex + 1>(context, result);
+    }
+  }
+
+  template <size_t kIndex>
+  void AppendDescriptions(std::string* description) const {
+    if constexpr (kIndex < kScannerCount) {
+      *description += kIndex == 0 ? "" : ",";
+      *description += std::get<kIndex>(scanners_).GetDescription();
+      AppendDescriptions<kIndex + 1>(description);
+    }
+  }
+
+  void ResetState() {
+    scanner_index_ = 0;
+    std::apply([](Scanners&... scanners) { (scanners.Reset(), ...); },
+               scanners_);
+  }
+
+  /// The scanners of the sequence.
+  std::tuple<Scanners...> scanners_;
+
+  /// The index of the scanner in progress, or kScannerCount once all of the
+  /// scanners have full matches.
+  size_t scanner_index_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_STATIC_DATA_SCANNER_H_  // NOLINT
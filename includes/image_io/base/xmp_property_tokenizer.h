@@ -0,0 +1,163 @@
+#ifndef IMAGE_IO_BASE_XMP_PROPERTY_TOKENIZER_H_  // NOLINT
+#define IMAGE_IO_BASE_XMP_PROPERTY_TOKENIZER_H_  // NOLINT
+
+#include <string>
+#include <vector>
+
+#include "image_io/base/data_line_map.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/static_data_scanner.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// A property found in XMP text by the XmpPropertyTokenizer, either in the
+/// attribute form prefix:name="value" or in the element form
+/// <prefix:name>value</prefix:name>.
+struct XmpProperty {
+  /// @param qualified_name A name of the form prefix:name, or just name.
+  /// @return Whether the prefix and name of the property match the given name.
+  bool HasQualifiedName(const char* qualified_name) const;
+
+  /// The namespace prefix of the property's name, e.g., "GDepth" for the name
+  /// "GDepth:Mime", or an empty string if the name has no prefix. Namespace
+  /// declarations are reported as properties with the "xmlns" prefix (or the
+  /// "xmlns" name, for the default namespace), whose value is the namespace
+  /// URI.
+  std::string prefix;
+
+  /// The name of the property without the prefix.
+  std::string name;
+
+  /// Whether the property is in the attribute rather than the element form.
+  bool is_attribute;
+
+  /// The data ranges of the bytes of the property's value, in order. There is
+  /// more than one range only if the value spans pieces of text that are not
+  /// adjacent in the data source, such as the chunks of an extended XMP packet.
+  /// The vector is empty if the value is.
+  std::vector<DataRange> value_ranges;
+};
+
+/// XmpPropertyProcessor is the abstract base class for the objects that are
+/// given the properties found by an XmpPropertyTokenizer.
+class XmpPropertyProcessor {
+ public:
+  virtual ~XmpPropertyProcessor() = default;
+
+  /// Called for each property, in the order the properties end in the text.
+  /// @param property The property. It is only valid for the duration of the
+  ///     call.
+  virtual void Process(const XmpProperty& property) = 0;
+};
+
+/// XmpPropertyTokenizer finds the properties in XMP text in a single pass over
+/// the bytes, passing them to an XmpPropertyProcessor as they are found. The
+/// text is pushed to the tokenizer in pieces that may end anywhere, even in the
+/// middle of a name or value, and that need not be adjacent in the data source
+/// (or even in the same data segment), so the text of a JpegSegment that spans
+/// two data segments, and the extended XMP packet that spans several APP1
+/// segments, can be tokenized without copying its bytes. The tokens are
+/// matched with the static data scanners, whose state carries over from one
+/// piece to the next. The tokenizer is lenient: markup that it does not
+/// understand, such as comments and processing instructions, is skipped rather
+/// than reported as an error, and so is any unexpected byte in a tag, after
+/// which the tokenizer goes on with the next attribute of the tag.
+class XmpPropertyTokenizer {
+ public:
+  /// @param processor The processor to pass the properties to.
+  explicit XmpPropertyTokenizer(XmpPropertyProcessor* processor);
+
+  /// Resets the tokenizer to the state it had when it was constructed, so that
+  /// it can tokenize another text.
+  void Reset();
+
+  /// Tokenizes the next piece of the text.
+  /// @param data_segment The data segment holding the piece.
+  /// @param range The range of the piece, which must be in the data segment.
+  void Tokenize(const DataSegment& data_segment, const DataRange& range);
+
+  /// @return Whether any malformed markup (a tag name, attribute or byte in a
+  ///     tag that was not expected) has been skipped since the tokenizer was
+  ///     constructed or reset, in which case some properties may have been
+  ///     missed.
+  bool HasSkippedMalformedMarkup() const {
+    return has_skipped_malformed_markup_;
+  }
+
+ private:
+  /// The states of the tokenizer, named after what it is looking for.
+  enum State {
+    kText,
+    kTagStart,
+    kMarkupEnd,
+    kTagName,
+    kTagContent,
+    kEmptyTagEnd,
+    kAttributeName,
+    kEquals,
+    kAttributeValue,
+    kEndTag,
+  };
+
+  static constexpr char kLessThan[] = "<";
+  static constexpr char kGreaterThan[] = ">";
+
+  /// Adds a range of the value of the property in progress.
+  /// @param begin The location of the first byte in the range.
+  /// @param end The location past the last byte in the range.
+  void AddValueRange(size_t begin, size_t end);
+
+  /// Sets the prefix and name of the property, and passes it to the processor.
+  /// @param qualified_name The qualified name of the property.
+  /// @param is_attribute Whether the property is in the attribute form.
+  void ProcessProperty(const std::string& qualified_name, bool is_attribute);
+
+  /// @param state The new state of the tokenizer.
+  void SetState(State state) { state_ = state; }
+
+  /// Notes that malformed markup was skipped, and sets the state.
+  /// @param state The new state of the tokenizer.
+  void SkipMalformedMarkup(State state) {
+    has_skipped_malformed_markup_ = true;
+    state_ = state;
+  }
+
+  /// The processor to pass the properties to.
+  XmpPropertyProcessor* processor_;
+
+  /// The state of the tokenizer.
+  State state_;
+
+  /// The qualified name of the tag or attribute in progress.
+  std::string qualified_name_;
+
+  /// The qualified name of the element whose start tag was the last tag, which
+  /// is a property if its end tag comes before any other tag.
+  std::string element_name_;
+
+  /// Whether the text after the last start tag is a candidate element value.
+  bool has_element_value_;
+
+  /// Whether any malformed markup has been skipped.
+  bool has_skipped_malformed_markup_;
+
+  /// The property passed to the processor, reused to avoid allocations.
+  XmpProperty property_;
+
+  /// The scanners used by the states.
+  ThroughLiteralScanner<kLessThan> text_scanner_;
+  ThroughLiteralScanner<kGreaterThan> markup_end_scanner_;
+  NameScanner name_scanner_;
+  OptionalWhitespaceScanner whitespace_scanner_;
+  QuotedStringScanner quoted_string_scanner_;
+
+  /// The (empty) line map used for the data contexts of the scanners.
+  DataLineMap data_line_map_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_BASE_XMP_PROPERTY_TOKENIZER_H_  // NOLINT
@@ -0,0 +1,35 @@
+#ifndef IMAGE_IO_EXTRAS_BASE64_DECODER_H_  // NOLINT
+#define IMAGE_IO_EXTRAS_BASE64_DECODER_H_  // NOLINT
+
+#include <cstddef>
+
+#include "image_io/base/types.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// Decodes a buffer of base64 encoded bytes. The bulk of the buffer is decoded
+/// with the widest vector instructions available on the running processor
+/// (AVX2 or SSE4.1 on x86, NEON on arm64); the remainder, including the final
+/// characters that may hold pad chars, is decoded by the modp_b64 library. Any
+/// part of the buffer that the vector code can't decode (for example because
+/// of an invalid character) is also left to modp_b64, so the results, including
+/// those for bad data, are the same as those of modp_b64_decode.
+/// @param src The source bytes to decode.
+/// @param len The number of source bytes to decode, a multiple of 4.
+/// @param out The output buffer to receive the decoded bytes. It must be at
+///     least len / 4 * 3 bytes long.
+/// @param pad_count The number of pad characters detected at the end of the
+///     src buffer.
+/// @return The number of decoded bytes placed in the out buffer, or 0 if there
+///     was a decoding error.
+size_t Base64Decode(const Byte* src, size_t len, Byte* out, size_t* pad_count);
+
+/// @return The name of the vector instruction set used by Base64Decode() on
+///     this processor: "avx2", "sse4.1", "neon" or "none".
+const char* GetBase64DecodeInstructionSetName();
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_EXTRAS_BASE64_DECODER_H_  // NOLINT
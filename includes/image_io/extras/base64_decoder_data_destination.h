@@ -2,10 +2,11 @@
 #define IMAGE_IO_EXTRAS_BASE64_DECODER_DATA_DESTINATION_H_  // NOLINT
 #define IMAGE_IO_noumenon_base64_h
 
-#include <vector>
+#include <memory>
 
 #include "image_io/base/data_destination.h"
 #include "image_io/base/message_handler.h"
+#include "image_io/base/segment_allocator.h"
 
 namespace photos_editing_formats {
 namespace image_io {
@@ -20,14 +21,35 @@ class Base64DecoderDataDestination : public DataDestination {
   /// @param message_handler An optional message handler to write messages to.
   Base64DecoderDataDestination(DataDestination* next_destination,
                                MessageHandler* message_handler)
+      : Base64DecoderDataDestination(next_destination, nullptr,
+                                     message_handler) {}
+
+  /// @param next_destination The next DataDestination in the chain which will
+  /// be sent the decoded bytes received by the Transfer() function.
+  /// @param segment_allocator An optional allocator of the data segments that
+  /// receive the decoded bytes, which then own their buffers and so can be
+  /// kept by the next destination. Without one, a single buffer is reused by
+  /// each Transfer() call. The allocator must outlive the destination.
+  /// @param message_handler An optional message handler to write messages to.
+  Base64DecoderDataDestination(DataDestination* next_destination,
+                               SegmentAllocator* segment_allocator,
+                               MessageHandler* message_handler)
       : next_destination_(next_destination),
+        segment_allocator_(segment_allocator),
         message_handler_(message_handler),
+        leftover_byte_count_(0),
+        decoded_buffer_size_(0),
         next_decoded_location_(0),
-        has_error_(false) {}
+        has_error_(false),
+        verbose_(false) {}
 
   /// @return True if there was an error in the decoding process.
   bool HasError() const { return has_error_; }
 
+  /// @param verbose Whether to report status messages about the leftover bytes
+  ///     of each Transfer() call to the message handler. Off by default.
+  void SetVerbose(bool verbose) { verbose_ = verbose; }
+
   void StartTransfer() override;
   TransferStatus Transfer(const DataRange& transfer_range,
                           const DataSegment& data_segment) override;
@@ -43,13 +65,41 @@ class Base64DecoderDataDestination : public DataDestination {
   /// The destination that the decoded data is sent to.
   DataDestination* next_destination_;
 
+  /// An optional allocator of the data segments holding the decoded bytes.
+  SegmentAllocator* segment_allocator_;
+
   /// An optional message handler to write messages to.
   MessageHandler* message_handler_;
 
+  /// Reports a status message with the number of leftover bytes if the verbose
+  /// mode is on and there is a message handler.
+  /// @param label The text that follows the number of bytes in the message.
+  void ReportLeftoverBytesStatus(const char* label);
+
+  /// @param size The number of decoded bytes that a Transfer() call produces.
+  /// @return The decoded_buffer_, first enlarged if it is smaller than size.
+  Byte* GetDecodedBuffer(size_t size);
+
   /// If the transfer_range parameter of the Transfer function does not have a
   /// length that is a multiple of 4, then the leftover bytes are placed in this
-  /// vector and are prepended to the data in the next call to Transfer.
-  std::vector<Byte> leftover_bytes_;
+  /// array and are prepended to the data in the next call to Transfer.
+  Byte leftover_bytes_[4];
+
+  /// The number of bytes in the leftover_bytes_ array, in the range [0:4].
+  size_t leftover_byte_count_;
+
+  /// The buffer that receives the decoded bytes of a Transfer() call before
+  /// they are sent to the next destination. It is reused by subsequent calls,
+  /// and only reallocated when a larger transfer comes along.
+  std::unique_ptr<Byte[]> decoded_buffer_;
+
+  /// The size of the decoded_buffer_.
+  size_t decoded_buffer_size_;
+
+  /// The data segment that refers to the decoded_buffer_, created by the first
+  /// Transfer() call that does not use the segment allocator and pointed at
+  /// the decoded bytes by each subsequent one.
+  std::shared_ptr<DataSegment> decoded_data_segment_;
 
   /// The DataRanges supplied to the Transfer function can't be sent down the
   /// chain to the next destination because the number of bytes differ (by 4/3).
@@ -59,6 +109,9 @@ class Base64DecoderDataDestination : public DataDestination {
 
   /// A true value indicates that an error occurred in the decoding process.
   bool has_error_;
+
+  /// Whether status messages are reported to the message handler.
+  bool verbose_;
 };
 
 }  // namespace image_io
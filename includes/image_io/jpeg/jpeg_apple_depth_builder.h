@@ -1,10 +1,11 @@
 #ifndef IMAGE_IO_JPEG_JPEG_APPLE_DEPTH_BUILDER_H_  // NOLINT
 #define IMAGE_IO_JPEG_JPEG_APPLE_DEPTH_BUILDER_H_  // NOLINT
 
-#include <vector>
+#include <memory>
 
 #include "image_io/base/data_destination.h"
 #include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
 #include "image_io/base/data_source.h"
 #include "image_io/base/message_handler.h"
 
@@ -90,8 +91,8 @@ class JpegAppleDepthBuilder {
   /// Jfif segment.
   DataRange primary_image_jfif_segment_range_;
 
-  /// The bytes of the primary image's Jfif segment.
-  std::vector<Byte> primary_image_jfif_segment_bytes_;
+  /// The data segment holding the bytes of the primary image's Jfif segment.
+  std::shared_ptr<DataSegment> primary_image_jfif_segment_;
 
   /// The range in the primary image data source containing the primary images's
   /// Mpf segment, or the location at a new Mpf segment should be written.
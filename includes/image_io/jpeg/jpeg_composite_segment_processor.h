@@ -0,0 +1,82 @@
+#ifndef IMAGE_IO_JPEG_JPEG_COMPOSITE_SEGMENT_PROCESSOR_H_  // NOLINT
+#define IMAGE_IO_JPEG_JPEG_COMPOSITE_SEGMENT_PROCESSOR_H_  // NOLINT
+
+#include <vector>
+
+#include "image_io/jpeg/jpeg_marker.h"
+#include "image_io/jpeg/jpeg_segment_processor.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// JpegCompositeSegmentProcessor is an implementation of JpegSegmentProcessor
+/// that passes the segments found by the JpegScanner on to any number of other
+/// processors, so that a single pass over the data serves all of them. The
+/// scanner looks for the union of the segment types the processors are
+/// interested in, and each processor is only sent the segments of the types it
+/// asked for. A processor that calls JpegScanner::SetDone() is not sent any
+/// more segments; the scanner itself is stopped when all of them are done.
+class JpegCompositeSegmentProcessor : public JpegSegmentProcessor {
+ public:
+  /// Adds a processor to the end of the list of processors to send segments
+  /// to. Segments are sent to the processors in the order they were added.
+  /// @param processor The processor to add. The composite processor does not
+  ///     take ownership of the processor, which must outlive the scan.
+  void AddProcessor(JpegSegmentProcessor* processor);
+
+  /// @return The number of processors that have been added.
+  size_t GetProcessorCount() const { return processor_states_.size(); }
+
+  /// @param index The index of the processor, in the order they were added.
+  /// @return Whether the processor called JpegScanner::SetDone() during the
+  ///     most recent scan.
+  bool IsProcessorDone(size_t index) const {
+    return index < processor_states_.size() && processor_states_[index].done;
+  }
+
+  void Start(JpegScanner* scanner) override;
+  void Process(JpegScanner* scanner, const JpegSegment& segment) override;
+  void Finish(JpegScanner* scanner) override;
+
+ private:
+  /// A processor and the information the scanner holds on its behalf.
+  struct ProcessorState {
+    explicit ProcessorState(JpegSegmentProcessor* a_processor)
+        : processor(a_processor), done(false) {}
+
+    /// The processor.
+    JpegSegmentProcessor* processor;
+
+    /// The types of segments the processor is interested in.
+    JpegMarker::Flags interesting_marker_flags;
+
+    /// Whether the processor is done.
+    bool done;
+  };
+
+  /// Records any change the processor that was just called made to the
+  /// scanner's interesting marker flags or done flag in its state, and clears
+  /// the scanner's done flag.
+  /// @param scanner The scanner the processor was called with.
+  /// @param state The state of the processor that was just called.
+  /// @return Whether the state of the processor was changed.
+  bool UpdateProcessorState(JpegScanner* scanner, ProcessorState* state);
+
+  /// Sets the scanner's interesting marker flags to the union of the flags of
+  /// the processors that are not done, or tells the scanner it is done if all
+  /// of them are.
+  /// @param scanner The scanner to update.
+  void UpdateScanner(JpegScanner* scanner);
+
+  /// The processors to send the segments to, and their states.
+  std::vector<ProcessorState> processor_states_;
+
+  /// The union of the interesting marker flags of the processors that are not
+  /// done.
+  JpegMarker::Flags interesting_marker_flags_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_JPEG_JPEG_COMPOSITE_SEGMENT_PROCESSOR_H_  // NOLINT
@@ -1,10 +1,14 @@
 #ifndef IMAGE_IO_JPEG_JPEG_IMAGE_EXTRACTOR_H_  // NOLINT
 #define IMAGE_IO_JPEG_JPEG_IMAGE_EXTRACTOR_H_  // NOLINT
 
+#include <memory>
+#include <vector>
+
 #include "image_io/base/data_destination.h"
 #include "image_io/base/data_source.h"
 #include "image_io/base/message_handler.h"
 #include "image_io/jpeg/jpeg_info.h"
+#include "image_io/utils/thread_pool.h"
 
 namespace photos_editing_formats {
 namespace image_io {
@@ -21,7 +25,24 @@ class JpegImageExtractor {
                      MessageHandler* message_handler)
       : jpeg_info_(jpeg_info),
         data_source_(data_source),
-        message_handler_(message_handler) {}
+        message_handler_(message_handler),
+        thread_pool_(nullptr) {}
+
+  /// Sets the thread pool used to decode the base64 encoded data of the
+  /// GDepth/GImage type images. With a pool, the encoded data is first read
+  /// from the data source (on the calling thread), then split into parts that
+  /// are decoded in parallel by the pool's workers and the calling thread into
+  /// a single buffer, which is sent to the image destination in one Transfer()
+  /// call. Small images are split into fewer parts. The calling thread decodes
+  /// any parts that no worker has started, so the extractor can be used by a
+  /// task running on the pool itself. Without a pool (the default) the data
+  /// is decoded on the calling thread as it is read.
+  /// @param thread_pool The thread pool to use, or nullptr. It must outlive
+  ///     the extractor.
+  void SetThreadPool(ThreadPool* thread_pool) { thread_pool_ = thread_pool; }
+
+  /// @return The thread pool used for decoding, or nullptr if there is none.
+  ThreadPool* GetThreadPool() const { return thread_pool_; }
 
   /// This function extracts the Apple depth image from the DataSource and sends
   /// the bytes to the DataDestination.
@@ -55,6 +76,25 @@ class JpegImageExtractor {
   bool ExtractImage(JpegXmpInfo::Type xmp_info_type,
                     DataDestination* image_destination);
 
+  /// Worker function called for GDepth/GImage type image extraction when the
+  /// locations of the base64 encoded property value bytes are known.
+  /// @param value_ranges The data ranges of the property value, in order.
+  /// @param image_destination The DataDestination to receive the image data.
+  /// @return True if the transfer succeeded.
+  bool ExtractXmpValue(const std::vector<DataRange>& value_ranges,
+                       DataDestination* image_destination);
+
+  /// Reads the base64 encoded property value and decodes it in parallel with
+  /// the thread_pool_.
+  /// @param value_ranges The data ranges of the property value, in order.
+  /// @param decoded_bytes Receives the buffer with the decoded bytes.
+  /// @param decoded_size Receives the number of decoded bytes.
+  /// @return True if the value was decoded. If false, the data could not be
+  ///     read or decoded, and no messages have been reported.
+  bool DecodeXmpValueInParallel(const std::vector<DataRange>& value_ranges,
+                                std::unique_ptr<Byte[]>* decoded_bytes,
+                                size_t* decoded_size);
+
   /// Worker function called for Apple depth/matte type image extraction.
   /// @param image_range The range of the image data to extract. If invalid,
   ///     the image_destination's StartTransfer/FinishTransfer functions are
@@ -73,6 +113,9 @@ class JpegImageExtractor {
 
   /// An optional message handler to write messages to.
   MessageHandler* message_handler_;
+
+  /// The optional thread pool used to decode GDepth/GImage data.
+  ThreadPool* thread_pool_;
 };
 
 }  // namespace image_io
@@ -1,6 +1,11 @@
 #ifndef IMAGE_IO_JPEG_JPEG_INFO_H_  // NOLINT
 #define IMAGE_IO_JPEG_JPEG_INFO_H_  // NOLINT
 
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "image_io/base/data_range.h"
@@ -14,7 +19,20 @@ namespace image_io {
 /// and where it is located so that it can be efficiently extracted.
 class JpegInfo {
  public:
-  JpegInfo() { JpegXmpInfo::InitializeVector(&xmp_info_vector_); }
+  /// The interned form of a segment info type, used to look up segment infos
+  /// without comparing type strings. The built in types have fixed tags; the
+  /// tags of other types are assigned as they are added to each JpegInfo.
+  using SegmentInfoTypeTag = size_t;
+
+  /// The tags of the built in segment info types.
+  static constexpr SegmentInfoTypeTag kJfifTypeTag = 0;
+  static constexpr SegmentInfoTypeTag kExifTypeTag = 1;
+  static constexpr SegmentInfoTypeTag kMpfTypeTag = 2;
+
+  /// The tag of the types for which there are no segment infos.
+  static constexpr SegmentInfoTypeTag kNoTypeTag = SIZE_MAX;
+
+  JpegInfo();
   JpegInfo(const JpegInfo&) = default;
   JpegInfo& operator=(const JpegInfo&) = default;
 
@@ -26,20 +44,27 @@ class JpegInfo {
     return segment_infos_;
   }
 
+  /// @param type The type of segment info.
+  /// @return The tag of the type, or kNoTypeTag if there are no segment infos
+  ///     of the type.
+  SegmentInfoTypeTag GetSegmentInfoTypeTag(const std::string& type) const;
+
   /// @param image_index The image containing the sought after segment info.
   /// @param type The type of segment info to get.
-  /// @return The segment info, or one that is invalid if not found.
-  JpegSegmentInfo GetSegmentInfo(size_t image_index,
-                                 const std::string& type) const {
-    for (const auto& segment_info : GetSegmentInfos()) {
-      if (segment_info.GetImageIndex() == image_index &&
-          segment_info.GetType() == type) {
-        return segment_info;
-      }
-    }
-    return JpegSegmentInfo(0, DataRange(), "");
+  /// @return The first segment info of the type in the image, or one that is
+  ///     invalid if not found.
+  const JpegSegmentInfo& GetSegmentInfo(size_t image_index,
+                                        const std::string& type) const {
+    return GetSegmentInfo(image_index, GetSegmentInfoTypeTag(type));
   }
 
+  /// @param image_index The image containing the sought after segment info.
+  /// @param type_tag The tag of the type of segment info to get.
+  /// @return The first segment info of the type in the image, or one that is
+  ///     invalid if not found.
+  const JpegSegmentInfo& GetSegmentInfo(size_t image_index,
+                                        SegmentInfoTypeTag type_tag) const;
+
   /// @return True if there is Apple depth information.
   bool HasAppleDepth() const { return apple_depth_image_range_.IsValid(); }
 
@@ -82,7 +107,7 @@ class JpegInfo {
 
   /// @param type The type of Xmp data to get the mime type of.
   /// @return The mime type for the Xmp data of the given type.
-  std::string GetMimeType(JpegXmpInfo::Type type) const {
+  const std::string& GetMimeType(JpegXmpInfo::Type type) const {
     return xmp_info_vector_[type].GetMimeType();
   }
 
@@ -93,17 +118,30 @@ class JpegInfo {
     return xmp_info_vector_[type].GetSegmentDataRanges();
   }
 
+  /// @param type The type of Xmp data to get the value data ranges of.
+  /// @return The data ranges of the Xmp property value of the given type, in
+  ///     value order, or an empty vector if they are not known.
+  const std::vector<DataRange>& GetValueDataRanges(
+      JpegXmpInfo::Type type) const {
+    return xmp_info_vector_[type].GetValueDataRanges();
+  }
+
   /// Adds a DataRange to the vector of image DataRanges.
   /// @param image_range The data range of an image.
   void AddImageRange(const DataRange& image_range) {
     image_ranges_.push_back(image_range);
   }
 
-  /// Adds a JpegSegmentInfo to the vector of JpegSegmentInfos.
+  /// Adds a JpegSegmentInfo to the vector of JpegSegmentInfos, and to the
+  /// index used to look them up.
   /// @param jpeg_segment_info The info structure to add.
-  void AddSegmentInfo(const JpegSegmentInfo& segment_info) {
-    segment_infos_.push_back(segment_info);
-  }
+  void AddSegmentInfo(JpegSegmentInfo segment_info);
+
+  /// Replaces the captured data segments of the segment infos that are kept
+  /// alive by another object (see DataSegment::HasBufferOwner()) with copies
+  /// of their bytes, so that an info that is kept for long does not keep the
+  /// memory of the data it was scanned from allocated.
+  void CompactSegmentInfos();
 
   /// @param data_range The DataRange where Apple depth information is located.
   void SetAppleDepthImageRange(const DataRange& data_range) {
@@ -128,6 +166,13 @@ class JpegInfo {
     xmp_info_vector_[type].SetSegmentDataRanges(segment_data_ranges);
   }
 
+  /// @param type The type of Xmp data to set value data ranges of.
+  /// @param value_data_ranges The ranges of the Xmp property value bytes.
+  void SetValueDataRanges(JpegXmpInfo::Type type,
+                          const std::vector<DataRange>& value_data_ranges) {
+    xmp_info_vector_[type].SetValueDataRanges(value_data_ranges);
+  }
+
  private:
   /// The DataRanges of all images.
   std::vector<DataRange> image_ranges_;
@@ -136,6 +181,28 @@ class JpegInfo {
   /// APP1/EXIF and APP2/MPF segments are saved here.
   std::vector<JpegSegmentInfo> segment_infos_;
 
+  /// The hash function of the keys of the segment info index. The hashes of
+  /// the image index and type tag are mixed with shifts and xors rather than
+  /// arithmetic, which could wrap around.
+  struct SegmentInfoKeyHash {
+    size_t operator()(const std::pair<size_t, SegmentInfoTypeTag>& key) const {
+      constexpr size_t kHalfBitCount = sizeof(size_t) * 4;
+      size_t first_hash = std::hash<size_t>()(key.first);
+      size_t second_hash = std::hash<size_t>()(key.second);
+      return first_hash ^ (second_hash << kHalfBitCount) ^
+             (second_hash >> kHalfBitCount);
+    }
+  };
+
+  /// The tags of the segment info types, by type.
+  std::unordered_map<std::string, SegmentInfoTypeTag> segment_info_type_tags_;
+
+  /// The index in segment_infos_ of the first segment info of each image index
+  /// and type tag.
+  std::unordered_map<std::pair<size_t, SegmentInfoTypeTag>, size_t,
+                     SegmentInfoKeyHash>
+      segment_info_index_;
+
   /// The DataRange of the Apple depth information.
   DataRange apple_depth_image_range_;
 
@@ -0,0 +1,191 @@
+#ifndef IMAGE_IO_JPEG_JPEG_INFO_BATCH_BUILDER_H_  // NOLINT
+#define IMAGE_IO_JPEG_JPEG_INFO_BATCH_BUILDER_H_  // NOLINT
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "image_io/base/data_source.h"
+#include "image_io/base/message.h"
+#include "image_io/base/message_handler.h"
+#include "image_io/base/segment_allocator.h"
+#include "image_io/jpeg/jpeg_info.h"
+#include "image_io/jpeg/jpeg_info_cache.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// The result of building the JpegInfo of one file of a batch.
+struct JpegInfoBatchResult {
+  /// The info of the file. If there were errors, it holds whatever was found
+  /// before the first of them.
+  JpegInfo info;
+
+  /// The messages reported while the file was opened and scanned.
+  std::vector<Message> messages;
+
+  /// @return Whether any of the messages is an error message.
+  bool HasErrors() const {
+    for (const auto& message : messages) {
+      if (message.IsError()) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+/// The throughput statistics of a JpegInfoBatchBuilder::Run() call.
+struct JpegInfoBatchStats {
+  JpegInfoBatchStats()
+      : thread_count(0),
+        file_count(0),
+        error_file_count(0),
+        cached_file_count(0),
+        bytes_read(0),
+        elapsed_seconds(0.0) {}
+
+  /// @return The number of files processed per second.
+  double GetFilesPerSecond() const {
+    return elapsed_seconds > 0.0 ? file_count / elapsed_seconds : 0.0;
+  }
+
+  /// @return The number of bytes read from the data sources per second.
+  double GetBytesPerSecond() const {
+    return elapsed_seconds > 0.0 ? bytes_read / elapsed_seconds : 0.0;
+  }
+
+  /// The number of threads that processed the files.
+  size_t thread_count;
+
+  /// The number of files in the batch.
+  size_t file_count;
+
+  /// The number of files whose results have errors.
+  size_t error_file_count;
+
+  /// The number of files whose info was found in the cache.
+  size_t cached_file_count;
+
+  /// The number of bytes in the data segments obtained from the data sources.
+  size_t bytes_read;
+
+  /// The wall clock time taken by the Run() call.
+  double elapsed_seconds;
+};
+
+/// JpegInfoBatchBuilder builds the JpegInfo of many files, using a pool of
+/// worker threads. Each worker has its own JpegScanner, message handler, read
+/// buffers and BlockSegmentAllocator that are reused from one file to the
+/// next, so that the threads do not compete for heap memory. The results are
+/// returned in the order of the files given to the Run() function, along with
+/// the messages reported for each file, and the throughput of the run is made
+/// available through GetStats().
+class JpegInfoBatchBuilder {
+ public:
+  /// A function that creates the data source for one file of the batch. It is
+  /// called on a worker thread.
+  /// @param segment_allocator The worker's allocator, which data sources that
+  ///     can be constructed with a SegmentAllocator should use.
+  /// @param message_handler The message handler to report errors to.
+  /// @return The data source, or nullptr if it could not be created.
+  using DataSourceFactory = std::function<std::unique_ptr<DataSource>(
+      SegmentAllocator*, MessageHandler*)>;
+
+  /// @param thread_count The number of worker threads to use. If zero, the
+  ///     number of hardware threads is used.
+  /// @param message_handler An optional message handler to which a status
+  ///     message with the throughput stats is written at the end of each run.
+  JpegInfoBatchBuilder(size_t thread_count, MessageHandler* message_handler)
+      : thread_count_(thread_count),
+        message_handler_(message_handler),
+        image_limit_(std::numeric_limits<int>::max()),
+        sparse_scanning_(false),
+        cache_(nullptr) {}
+
+  /// @param image_limit The max number of images to process in each file. By
+  ///     default there is no limit. See JpegInfoBuilder::SetImageLimit().
+  void SetImageLimit(int image_limit) { image_limit_ = image_limit; }
+
+  /// @param type The type of segment info to capture the bytes of. See
+  ///     JpegInfoBuilder::SetCaptureSegmentBytes().
+  void SetCaptureSegmentBytes(const std::string& segment_info_type) {
+    capture_segment_info_types_.insert(segment_info_type);
+  }
+
+  /// @param sparse_scanning Whether the scanners use the sparse scanning mode.
+  ///     See JpegScanner::SetSparseScanning().
+  void SetSparseScanning(bool sparse_scanning) {
+    sparse_scanning_ = sparse_scanning;
+  }
+
+  /// @param cache An optional cache, used by the Run() function that takes file
+  ///     names. Files whose info is in the cache are not scanned, and the info
+  ///     of the files that are scanned without errors is added to the cache.
+  void SetCache(JpegInfoCache* cache) { cache_ = cache; }
+
+  /// Builds the JpegInfo of the named files. The files are read with pread(2)
+  /// via FdDataSource instances.
+  /// @param file_names The names of the files.
+  /// @return The results, in the order of the file names.
+  std::vector<JpegInfoBatchResult> Run(
+      const std::vector<std::string>& file_names);
+
+  /// Builds the JpegInfo of the files whose data sources are created by the
+  /// given factories.
+  /// @param data_source_factories The factories of the data sources.
+  /// @return The results, in the order of the factories.
+  std::vector<JpegInfoBatchResult> Run(
+      const std::vector<DataSourceFactory>& data_source_factories);
+
+  /// @return The stats of the last Run() call.
+  const JpegInfoBatchStats& GetStats() const { return stats_; }
+
+ private:
+  class Worker;
+
+  /// Runs the batch, calling the function for each file on a worker thread.
+  /// @param file_count The number of files in the batch.
+  /// @param process_file The function that fills in the result of a file.
+  /// @return The results of the files.
+  std::vector<JpegInfoBatchResult> RunBatch(
+      size_t file_count,
+      const std::function<void(Worker* worker, size_t file_index,
+                               JpegInfoBatchResult* result)>& process_file);
+
+  /// Scans a data source with the worker's scanner and a new info builder.
+  /// @param worker The worker running on this thread.
+  /// @param data_source The data source of the file.
+  /// @param result The result whose info is set.
+  void ScanDataSource(Worker* worker, DataSource* data_source,
+                      JpegInfoBatchResult* result) const;
+
+  /// The number of worker threads to use.
+  size_t thread_count_;
+
+  /// An optional message handler for the stats message.
+  MessageHandler* message_handler_;
+
+  /// The image limit of the info builders.
+  int image_limit_;
+
+  /// The types of segment info whose bytes are captured by the info builders.
+  std::set<std::string> capture_segment_info_types_;
+
+  /// Whether the scanners use the sparse scanning mode.
+  bool sparse_scanning_;
+
+  /// An optional cache of infos.
+  JpegInfoCache* cache_;
+
+  /// The stats of the last run.
+  JpegInfoBatchStats stats_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_JPEG_JPEG_INFO_BATCH_BUILDER_H_  // NOLINT
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "image_io/base/data_range.h"
+#include "image_io/base/multi_pattern_matcher.h"
 #include "image_io/jpeg/jpeg_info.h"
 #include "image_io/jpeg/jpeg_segment_processor.h"
 #include "image_io/jpeg/jpeg_xmp_info_builder.h"
@@ -34,6 +35,15 @@ class JpegInfoBuilder : public JpegSegmentProcessor {
   /// @param type The type of segment info to capture the value of.
   void SetCaptureSegmentBytes(const std::string& segment_info_type);
 
+  /// Registers an XMP namespace id of interest. The primary XMP segments that
+  /// declare a namespace whose URI contains the id are added to the JpegInfo
+  /// as segment infos whose type is the id; their bytes are captured if the
+  /// SetCaptureSegmentBytes() function is called with the id. The ids are all
+  /// matched in a single pass, so registering more of them does not add to
+  /// the cost of classifying the segments.
+  /// @param xmp_id The namespace id, e.g., "http://ns.example.com/data/1.0/".
+  void AddXmpId(const std::string& xmp_id);
+
   /// @return True if the segment is a primary Xmp segment.
   bool IsPrimaryXmpSegment(const JpegSegment& segment) const;
 
@@ -60,32 +70,33 @@ class JpegInfoBuilder : public JpegSegmentProcessor {
   /// @return True if the segment is an Jfif segment.
   bool IsJfifSegment(const JpegSegment& segment) const;
 
-  /// Captures the segment bytes into the a JpegSegmentInfo's byte vector if
+  /// Captures the segment bytes into the a JpegSegmentInfo's data segment if
   /// the SetCaptureSegmentBytes() has been called for the segment info type.
+  /// The data segment is a view of the scanned bytes if possible, so that the
+  /// bytes don't have to be copied.
   /// @param type The type of segment info being processed.
   /// @param segment The segment being processed.
-  /// @param bytes A vector to hold the segment bytes.
+  /// @param segment_info The segment info to hold the segment bytes.
   void MaybeCaptureSegmentBytes(const std::string& type,
                                 const JpegSegment& segment,
-                                std::vector<Byte>* bytes) const;
+                                JpegSegmentInfo* segment_info) const;
+
+  /// Tells the scanner about the ranges of the images that are listed in the MP
+  /// entries of the primary image's APP2/MPF segment, so that it can skip over
+  /// their entropy coded data in its sparse scanning mode.
+  /// @param scanner The scanner to give the image range hints to.
+  /// @param segment The APP2/MPF segment of the primary image.
+  void AddMpfImageRangeHints(JpegScanner* scanner,
+                             const JpegSegment& segment) const;
 
   /// @return True if the segment's extended xmp guid matches the one from the
   ///     primary xmp segment.
   bool HasMatchingExtendedXmpGuid(const JpegSegment& segment) const;
 
-  /// @return True if the segment contains the given id.
-  bool HasId(const JpegSegment& segment, const char* id) const;
-
-  /// Sets the primary segment guid value using properties in the given segment.
-  /// @param The segment from which to obtain the primary xmp guid value.
-  void SetPrimaryXmpGuid(const JpegSegment& segment);
-
-  /// Sets the Xmp mime type using property values in the given segment.
-  /// @param The segment from which to obtain the mime property value.
-  /// @param xmp_info_type The type of xmp data that determines the mime
-  ///     property name to look for.
-  void SetXmpMimeType(const JpegSegment& segment,
-                      JpegXmpInfo::Type xmp_info_type);
+  /// Processes a primary XMP segment, whose properties are all found in a
+  /// single pass over its bytes.
+  /// @param segment The primary XMP segment.
+  void ProcessPrimaryXmpSegment(const JpegSegment& segment);
 
   /// The limit on the number of images to process. After this many images have
   /// been found, the Process() function will tell the JpegScanner to stop.
@@ -113,6 +124,12 @@ class JpegInfoBuilder : public JpegSegmentProcessor {
   /// the range of the image that represents the Apple depth data.
   DataRange most_recent_soi_marker_range_;
 
+  /// The matcher of the XMP namespace ids, the built in ones first.
+  MultiPatternMatcher xmp_id_matcher_;
+
+  /// The indices in the xmp_id_matcher_ of the ids added with AddXmpId().
+  std::vector<size_t> added_xmp_id_indices_;
+
   /// The GUID value of the APP1/XMP segments that contain GDepth/GImage data.
   std::string primary_xmp_guid_;
 
@@ -0,0 +1,115 @@
+#ifndef IMAGE_IO_JPEG_JPEG_INFO_CACHE_H_  // NOLINT
+#define IMAGE_IO_JPEG_JPEG_INFO_CACHE_H_  // NOLINT
+
+#include <map>
+#include <mutex>  // NOLINT
+#include <string>
+#include <utility>
+
+#include "image_io/base/message_handler.h"
+#include "image_io/base/types.h"
+#include "image_io/jpeg/jpeg_info.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// A JpegInfoCache holds the JpegInfo of files that have already been scanned,
+/// so that the files need not be scanned again. The files are identified by
+/// their device and inode numbers, so the cache is not fooled by renames or
+/// links, and an entry is only used if the size and modification time of the
+/// file are still the same as when the entry was added. The entries can be
+/// saved to an index file and loaded from it again, so the cache can persist
+/// from one run of the program to the next. All the functions of the class are
+/// thread safe.
+class JpegInfoCache {
+ public:
+  /// @param message_handler An optional message handler for writing messages.
+  explicit JpegInfoCache(MessageHandler* message_handler)
+      : message_handler_(message_handler) {}
+  JpegInfoCache(const JpegInfoCache&) = delete;
+  JpegInfoCache& operator=(const JpegInfoCache&) = delete;
+
+  /// @param file_name The name of the file to look up.
+  /// @param info A pointer to the info to receive the cached value.
+  /// @return Whether the cache has an entry for the file that is still valid.
+  bool Lookup(const std::string& file_name, JpegInfo* info) const;
+
+  /// Adds an entry to the cache, replacing any existing entry for the file.
+  /// The captured segment bytes of the entry's info are compacted (see
+  /// JpegInfo::CompactSegmentInfos()), so that the cache does not keep the
+  /// memory of the scanned data allocated.
+  /// @param file_name The name of the file whose info is given.
+  /// @param info The info obtained by scanning the file.
+  /// @return Whether the entry was added; false if the file can not be found.
+  bool Insert(const std::string& file_name, const JpegInfo& info);
+
+  /// @return The number of entries in the cache.
+  size_t GetSize() const;
+
+  /// Removes all entries from the cache.
+  void Clear();
+
+  /// Adds the entries in an index file written by Save() to the cache. Entries
+  /// in the file replace those already in the cache for the same files.
+  /// @param index_file_name The name of the index file to load.
+  /// @return Whether the file was loaded. It is not an error for the file to
+  ///     not exist, but false is returned in that case as well.
+  bool Load(const std::string& index_file_name);
+
+  /// Writes the entries of the cache to an index file. The entries are written
+  /// to a temporary file in the same directory, which is then renamed to the
+  /// index file, so that a reader or a failed write never sees a partial one.
+  /// @param index_file_name The name of the index file to write.
+  /// @return Whether the file was written successfully.
+  bool Save(const std::string& index_file_name) const;
+
+ private:
+  /// The values used to identify a file and to tell whether it has changed.
+  struct FileIdentity {
+    FileIdentity()
+        : device(0),
+          inode(0),
+          size(0),
+          modification_seconds(0),
+          modification_nanoseconds(0) {}
+    UInt64 device;
+    UInt64 inode;
+    UInt64 size;
+    /// The seconds (the bits of the signed value) and nanoseconds parts of the
+    /// modification time. They are kept apart since the time may not fit in a
+    /// single count of nanoseconds.
+    UInt64 modification_seconds;
+    UInt64 modification_nanoseconds;
+  };
+
+  /// A cached info and the size and modification time of its file.
+  struct Entry {
+    UInt64 size;
+    UInt64 modification_seconds;
+    UInt64 modification_nanoseconds;
+    JpegInfo info;
+  };
+
+  /// The (device, inode) pair that is the key of the entries map.
+  using Key = std::pair<UInt64, UInt64>;
+
+  /// @param file_name The name of the file to get the identity of.
+  /// @param identity A pointer to the identity to fill in.
+  /// @return Whether the file's identity was obtained.
+  static bool GetFileIdentity(const std::string& file_name,
+                              FileIdentity* identity);
+
+  /// An optional message handler to write messages to.
+  MessageHandler* message_handler_;
+
+  /// The mutex that guards the entries.
+  mutable std::mutex mutex_;
+
+  /// The entries of the cache.
+  std::map<Key, Entry> entries_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_JPEG_JPEG_INFO_CACHE_H_  // NOLINT
@@ -0,0 +1,53 @@
+#ifndef IMAGE_IO_JPEG_JPEG_INFO_SERIALIZATION_H_  // NOLINT
+#define IMAGE_IO_JPEG_JPEG_INFO_SERIALIZATION_H_  // NOLINT
+
+#include <vector>
+
+#include "image_io/base/types.h"
+#include "image_io/jpeg/jpeg_info.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// Functions to convert a JpegInfo to and from a compact binary form, so that
+/// the info for a file can be saved and used again without scanning the file.
+/// The binary form starts with a four byte tag and a version number, and all
+/// the numbers in it are written with a variable length (LEB128) encoding, so
+/// that the small numbers that make up most of a JpegInfo take a byte or two.
+
+/// Appends the variable length encoding of a number, as used in the binary form
+/// of a JpegInfo, to a byte vector. Files that hold binary forms of JpegInfos,
+/// such as the index file of a JpegInfoCache, use it for their own numbers.
+/// @param value The number to encode.
+/// @param bytes The vector to append the encoded bytes to.
+void SerializeJpegInfoNumber(UInt64 value, std::vector<Byte>* bytes);
+
+/// Decodes a number that was encoded by SerializeJpegInfoNumber().
+/// @param data The bytes that start with the encoded number.
+/// @param size The number of bytes available in data.
+/// @param value A pointer to the variable to receive the number.
+/// @return The number of bytes used by the encoded number, or 0 if the bytes do
+///     not contain a valid encoded number.
+size_t DeserializeJpegInfoNumber(const Byte* data, size_t size, UInt64* value);
+
+/// Appends the binary form of a JpegInfo to a byte vector. This includes the
+/// image ranges, the segment infos (with their bytes if they were captured),
+/// the Apple depth and matte image ranges, and the mime types and segment data
+/// ranges of the Xmp data.
+/// @param info The info to serialize.
+/// @param bytes The vector to append the binary form to.
+void SerializeJpegInfo(const JpegInfo& info, std::vector<Byte>* bytes);
+
+/// Recreates a JpegInfo from the binary form written by SerializeJpegInfo().
+/// @param data The bytes that start with the binary form.
+/// @param size The number of bytes available in data.
+/// @param info A pointer to the info to receive the values. It is only changed
+///     if the bytes contain a complete and valid binary form.
+/// @return The number of bytes used by the binary form, or 0 if the bytes do
+///     not contain a complete and valid binary form.
+size_t DeserializeJpegInfo(const Byte* data, size_t size, JpegInfo* info);
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_JPEG_JPEG_INFO_SERIALIZATION_H_  // NOLINT
@@ -2,7 +2,9 @@
 #define IMAGE_IO_JPEG_JPEG_SCANNER_H_  // NOLINT
 
 #include <memory>
+#include <vector>
 
+#include "image_io/base/data_range.h"
 #include "image_io/base/data_segment.h"
 #include "image_io/base/data_source.h"
 #include "image_io/base/message_handler.h"
@@ -14,7 +16,8 @@ namespace image_io {
 
 /// JpegScanner reads DataSegments from a DataSource, finds interesting
 /// JpegSegments and passes them on to a JpegSegmentProcessor for further
-/// examination.
+/// examination. Alternatively, the DataSegments can be fed to the scanner as
+/// they become available using the Start(), Feed() and Finish() functions.
 class JpegScanner {
  public:
   explicit JpegScanner(MessageHandler* message_handler)
@@ -23,37 +26,129 @@ class JpegScanner {
         segment_processor_(nullptr),
         current_location_(0),
         done_(false),
-        has_error_(false) {}
+        has_error_(false),
+        sparse_scanning_(false),
+        feed_state_(kFeedFindMarker),
+        segment_begin_(0),
+        segment_end_(0) {
+    UpdateInterestingMarkerFlags(JpegMarker::Flags());
+  }
 
   /// Called to start and run the scanner.
   /// @param data_source The DataSource from which to obtain DataSegments.
   /// @param segment_processor The processor of the JpegSegment instances.
   void Run(DataSource* data_source, JpegSegmentProcessor* segment_processor);
 
+  /// Called to start an incremental scan, in which the data is pushed to the
+  /// scanner with the Feed() function instead of pulled from a DataSource. The
+  /// processor's Start() function is called before this function returns.
+  /// @param segment_processor The processor of the JpegSegment instances.
+  void Start(JpegSegmentProcessor* segment_processor);
+
+  /// Scans the next piece of the data in an incremental scan. The scanner keeps
+  /// its state between calls, so markers and segments may be split across any
+  /// number of DataSegments, which need not outlive the call. The DataSegments
+  /// must be fed in order; bytes that precede the current location are ignored
+  /// and a gap in the data is an error unless it falls entirely within the
+  /// payload of an uninteresting segment. The JpegSegment instances passed to
+  /// the processor refer to the fed DataSegment when they fit in it, and to an
+  /// internal copy of their bytes otherwise.
+  /// @param data_segment The next DataSegment of the JPEG data.
+  void Feed(const DataSegment& data_segment);
+
+  /// Ends an incremental scan that was started with the Start() function and
+  /// calls the processor's Finish() function. An error is reported if the data
+  /// ended in the middle of an interesting segment.
+  void Finish();
+
   /// If the JpegSegmentProcessor determines that it has seen enough JpegSegment
   /// instances, it can call this function to terminate the scanner prematurely.
   void SetDone() { done_ = true; }
 
+  /// Clears the done flag set by SetDone(). A JpegSegmentProcessor that passes
+  /// the segments on to other processors can call this function to keep the
+  /// scanner running when only some of those processors are done.
+  void ClearDone() { done_ = false; }
+
   /// @return True if the done flag was set by SetDone(), else false.
   bool IsDone() const { return done_; }
 
   /// @return True if the scanner encountered errors.
   bool HasError() const { return has_error_; }
 
+  /// By default the scanner reads every byte of the DataSource. In the sparse
+  /// scanning mode the scanner instead uses the length of each uninteresting
+  /// segment to jump over its payload without reading it, and uses the image
+  /// range hints provided by the JpegSegmentProcessor to jump from the start of
+  /// an image's entropy coded data straight to its EOI marker. Segments that
+  /// occur between the first SOS marker and the EOI marker of such an image
+  /// are not seen by the processor.
+  /// @param sparse_scanning Whether to use the sparse scanning mode.
+  void SetSparseScanning(bool sparse_scanning) {
+    sparse_scanning_ = sparse_scanning;
+  }
+
+  /// @return Whether the sparse scanning mode is in use.
+  bool IsSparseScanning() const { return sparse_scanning_; }
+
+  /// JpegSegmentProcessor instances can call this function to tell the scanner
+  /// where an image is expected to begin and end, for example from the offsets
+  /// and sizes in an APP2/MPF segment. The hints are only used in the sparse
+  /// scanning mode, and the scanner verifies that an EOI marker is present at
+  /// the end of the range before it skips any data. The hints are cleared each
+  /// time the Run() function is called.
+  /// @param image_range The range of the image from its SOI to its EOI marker.
+  void AddImageRangeHint(const DataRange& image_range) {
+    image_range_hints_.push_back(image_range);
+  }
+
   /// @return The DataSource from which DataSegments are being read.
   DataSource* GetDataSource() const { return data_source_; }
 
   /// JpegSegmentProcessor instances can call this function to inform the
   /// scanner about the types of JpegSegment instances it is interested in.
   /// The JpegScanner will not send any uninteresting segments to the processor.
-  void UpdateInterestingMarkerFlags(const JpegMarker::Flags& marker_flags) {
-    interesting_marker_flags_ = marker_flags;
+  void UpdateInterestingMarkerFlags(const JpegMarker::Flags& marker_flags);
+
+  /// @return The JpegSegment types of interest to the JpegSegmentProcessor.
+  const JpegMarker::Flags& GetInterestingMarkerFlags() const {
+    return interesting_marker_flags_;
   }
 
  private:
+  /// The states of an incremental scan. Each state but the first indicates the
+  /// part of the JpegSegment that the next fed byte belongs to.
+  enum FeedState {
+    kFeedFindMarker,
+    kFeedMarkerType,
+    kFeedPayloadSize,
+    kFeedSegment,
+    kFeedSkipPayload,
+  };
+
+  /// Called from the Feed() function to scan the bytes of the data segment in
+  /// the current state, starting at the current location.
+  /// @param data_segment The DataSegment that contains the current location.
+  void FeedBytes(const DataSegment& data_segment);
+
+  /// Sends the JpegSegment whose bytes were collected in segment_bytes_ to the
+  /// processor.
+  void ProcessCollectedSegment();
+
+  /// Reports the error that occurs when the bytes of a segment are missing.
+  /// @param location The location of the first missing byte.
+  void ReportPrematureEndOfData(size_t location);
+
   /// Called from the Run() function to do the heavy lifting.
   void FindAndProcessSegments();
 
+  /// Finds the next location in the current DataSegment at or after the
+  /// current location that may start a JpegSegment of interest. Zero bytes,
+  /// fill bytes and uninteresting markers without a payload are skipped over.
+  /// @return The location of the candidate marker, or the end of the current
+  ///     DataSegment if there is none.
+  size_t FindMarkerCandidate() const;
+
   /// @param marker The marker of the JpegSegment under construction.
   /// @param begin_location The start of the JpegSegment under construction.
   /// @return The size of the segment payload of given marker type that starts
@@ -71,6 +166,16 @@ class JpegScanner {
   /// Asks the DataSource for the next DataSegment.
   void GetNextSegment();
 
+  /// @return The size of the DataSegment to request from the DataSource when
+  ///     the scanner starts or jumps to a location that is not contiguous with
+  ///     the data it has already read.
+  size_t GetJumpDataRequestSize() const;
+
+  /// Called after an SOS segment in the sparse scanning mode. If an image range
+  /// hint contains the current location and there is an EOI marker at the end
+  /// of the range, the scanner moves the current location to that marker.
+  void MaybeSkipEntropyData();
+
  private:
   /// An optional message handler to write messages to.
   MessageHandler* message_handler_;
@@ -84,6 +189,11 @@ class JpegScanner {
   /// The JpegSegment types of interest to the JpegSegmentProcessor.
   JpegMarker::Flags interesting_marker_flags_;
 
+  /// The marker types that FindMarkerCandidate() can skip over: the zero and
+  /// fill bytes, and the uninteresting types that have no payload, such as the
+  /// RSTn markers that are scattered through the entropy coded data.
+  JpegMarker::Flags skippable_marker_flags_;
+
   /// Depending on the DataSource, a given JpegSegment may span up to two
   /// DataSegments. These are they.
   std::shared_ptr<DataSegment> current_segment_;
@@ -97,6 +207,24 @@ class JpegScanner {
 
   /// A flag that indicates an error occurred while getting Byte data.
   bool has_error_;
+
+  /// A flag that indicates the sparse scanning mode is in use.
+  bool sparse_scanning_;
+
+  /// The image range hints provided by the JpegSegmentProcessor.
+  std::vector<DataRange> image_range_hints_;
+
+  /// The state of an incremental scan.
+  FeedState feed_state_;
+
+  /// The range of the JpegSegment under construction in an incremental scan.
+  /// The end is only known once the payload size bytes have been fed.
+  size_t segment_begin_;
+  size_t segment_end_;
+
+  /// The bytes of the JpegSegment under construction in an incremental scan,
+  /// used when the segment spans more than one fed DataSegment.
+  std::vector<Byte> segment_bytes_;
 };
 
 }  // namespace image_io
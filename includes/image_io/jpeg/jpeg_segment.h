@@ -1,8 +1,12 @@
 #ifndef IMAGE_IO_JPEG_JPEG_SEGMENT_H_  // NOLINT
 #define IMAGE_IO_JPEG_JPEG_SEGMENT_H_  // NOLINT
 
+#include <memory>
+#include <string>
+
 #include "image_io/base/data_range.h"
 #include "image_io/base/data_segment.h"
+#include "image_io/base/xmp_property_tokenizer.h"
 #include "image_io/jpeg/jpeg_marker.h"
 
 namespace photos_editing_formats {
@@ -76,6 +80,21 @@ class JpegSegment {
                                                    end_segment_);
   }
 
+  /// Gets the span of bytes starting at the location that are all in one of
+  /// the underlying DataSegments, so that they can be accessed directly. The
+  /// span of a segment that lies entirely in one DataSegment is the rest of
+  /// the segment; otherwise a second call is needed to get the bytes in the
+  /// other DataSegment. Like GetValidatedByte(), this function does not limit
+  /// the span to the segment's range.
+  /// @param location The location of the first byte of the span.
+  /// @param end_location The location past the last byte wanted.
+  /// @param bytes Receives the pointer to the first byte of the span, or the
+  ///     nullptr if there are no bytes at the location.
+  /// @return The length of the span, which is at most end_location - location
+  ///     and is zero if there are no bytes at the location.
+  size_t GetContiguousBytes(size_t location, size_t end_location,
+                            const Byte** bytes) const;
+
   /// @return The payload size or zero if the segment's marker indicates the
   ///     segment does not have a payload. The payload size includes the two
   ///     bytes that encode the length of the payload. I.e., the payload data
@@ -130,12 +149,33 @@ class JpegSegment {
   ///     GetEnd() if the final quote was not found.
   size_t FindXmpPropertyValueEnd(size_t start_location) const;
 
+  /// Passes the bytes in the data range to the tokenizer, in one piece for
+  /// each of the underlying DataSegments that holds some of them, so that all
+  /// the properties in the range are found in a single pass over its bytes.
+  /// @param data_range The range of the XMP text in the segment.
+  /// @param tokenizer The tokenizer to pass the bytes to.
+  void TokenizeXmpProperties(const DataRange& data_range,
+                             XmpPropertyTokenizer* tokenizer) const;
+
   /// @param The DataRange to use to extract a string from the segment's bytes.
   /// @return The string extracted from the segment at locations indicated by
   ///     the data_range, or an empty string if the data_range is not contained
   ///     in the segment's range, or any invalid or zero bytes are encountered.
   std::string ExtractString(const DataRange& data_range) const;
 
+  /// @param The DataRange of the segment's bytes to extract.
+  /// @return A DataSegment with the given range holding the segment's bytes,
+  ///     or nullptr if the data_range is not contained in the segment's range
+  ///     or any invalid bytes are encountered. If the bytes are at least half
+  ///     of those of one underlying DataSegment that owns its buffer and has
+  ///     no buffer owner, the returned segment is a view of it (see
+  ///     DataSegment::CreateView()) and no bytes are copied; otherwise the
+  ///     bytes are copied to a new buffer, so that the segment does not keep
+  ///     a much larger buffer allocated. Either way, the returned segment
+  ///     remains valid after the scan of the segment is over.
+  std::shared_ptr<DataSegment> ExtractDataSegment(
+      const DataRange& data_range) const;
+
   /// @return the JpegMarker of this segment.
   JpegMarker GetMarker() const {
     size_t marker_type_location = GetMarkerLocation() + 1;
@@ -160,6 +200,12 @@ class JpegSegment {
                                 std::string* ascii_string) const;
 
  private:
+  /// Copies the bytes in the range from the underlying DataSegments.
+  /// @param data_range The range of bytes to copy.
+  /// @param bytes The buffer to copy the bytes to.
+  /// @return Whether all the bytes in the range were available.
+  bool CopyBytes(const DataRange& data_range, Byte* bytes) const;
+
   /// The DataRange of the JpegSegment.
   DataRange data_range_;
 
@@ -1,10 +1,13 @@
 #ifndef IMAGE_IO_JPEG_JPEG_SEGMENT_INFO_H_  // NOLINT
 #define IMAGE_IO_JPEG_JPEG_SEGMENT_INFO_H_  // NOLINT
 
+#include <cstring>
+#include <memory>
 #include <string>
-#include <vector>
+#include <utility>
 
 #include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
 #include "image_io/base/types.h"
 
 namespace photos_editing_formats {
@@ -36,7 +39,7 @@ class JpegSegmentInfo {
   /// @return Whether the segment infos are equal
   bool operator==(const JpegSegmentInfo& rhs) const {
     return image_index_ == rhs.image_index_ && data_range_ == rhs.data_range_ &&
-           type_ == rhs.type_ && bytes_ == rhs.bytes_;
+           type_ == rhs.type_ && HasSameBytes(rhs);
   }
 
   /// @param rhs The segment info to compare with this one.
@@ -57,15 +60,37 @@ class JpegSegmentInfo {
   /// @return The type of the segment info.
   const std::string& GetType() const { return type_; }
 
-  /// @return The (optional) bytes of the segment to which the info refers.  The
-  ///     vector will be empty unless the GetMutableBytes() function has been
-  ///     and the vector filled with the segment contents.
-  const std::vector<Byte>& GetBytes() const { return bytes_; }
+  /// @return The (optional) data segment holding the bytes of the segment to
+  ///     which the info refers, or nullptr unless the bytes have been captured
+  ///     (see JpegInfoBuilder::SetCaptureSegmentBytes()). The data segment may
+  ///     be a view of the DataSegment that was scanned (see
+  ///     JpegSegment::ExtractDataSegment()), and remains valid after the scan.
+  const std::shared_ptr<DataSegment>& GetDataSegment() const {
+    return data_segment_;
+  }
+
+  /// @param data_segment The data segment holding the bytes of the segment.
+  void SetDataSegment(std::shared_ptr<DataSegment> data_segment) {
+    data_segment_ = std::move(data_segment);
+  }
 
-  /// @return A non-const pointer to the bytes vector.
-  std::vector<Byte>* GetMutableBytes() { return &bytes_; }
+  /// @return The number of captured bytes of the segment, or 0 if none.
+  size_t GetByteCount() const {
+    return data_segment_ ? data_segment_->GetLength() : 0;
+  }
 
  private:
+  /// @param rhs The segment info to compare with this one.
+  /// @return Whether the captured bytes of the segment infos are equal.
+  bool HasSameBytes(const JpegSegmentInfo& rhs) const {
+    size_t byte_count = GetByteCount();
+    return byte_count == rhs.GetByteCount() &&
+           (byte_count == 0 ||
+            memcmp(data_segment_->GetBuffer(data_segment_->GetBegin()),
+                   rhs.data_segment_->GetBuffer(rhs.data_segment_->GetBegin()),
+                   byte_count) == 0);
+  }
+
   // The image index where the segment is located.
   size_t image_index_;
 
@@ -75,8 +100,8 @@ class JpegSegmentInfo {
   // The type of segment.
   std::string type_;
 
-  // The (optional) bytes of the segment.
-  std::vector<Byte> bytes_;
+  // The (optional) data segment holding the bytes of the segment.
+  std::shared_ptr<DataSegment> data_segment_;
 };
 
 }  // namespace image_io
@@ -60,7 +60,7 @@ class JpegXmpInfo {
   Type GetType() const { return type_; }
 
   /// @return The mime type of the Xmp data.
-  std::string GetMimeType() const { return mime_type_; }
+  const std::string& GetMimeType() const { return mime_type_; }
 
   /// @param mime_type The mime type to assign to this instance.
   void SetMimeType(const std::string& mime_type) { mime_type_ = mime_type; }
@@ -75,6 +75,20 @@ class JpegXmpInfo {
     segment_data_ranges_ = segment_data_ranges;
   }
 
+  /// @return The data ranges of the bytes of the Xmp property value, in the
+  ///     order in which they form the value. The ranges are located in the
+  ///     segments returned by GetSegmentDataRanges(), but the order in which
+  ///     they appear in the file may differ. This vector is empty if the value
+  ///     could not be located from the extended xmp chunk offsets.
+  const std::vector<DataRange>& GetValueDataRanges() const {
+    return value_data_ranges_;
+  }
+
+  /// @param The value data ranges to assign to this instance.
+  void SetValueDataRanges(const std::vector<DataRange>& value_data_ranges) {
+    value_data_ranges_ = value_data_ranges;
+  }
+
  private:
   /// The type of the Xmp information.
   Type type_;
@@ -84,6 +98,9 @@ class JpegXmpInfo {
 
   /// The segment data ranges that contain the Xmp data.
   std::vector<DataRange> segment_data_ranges_;
+
+  /// The data ranges of the Xmp property value, in value order.
+  std::vector<DataRange> value_data_ranges_;
 };
 
 }  // namespace image_io
@@ -10,30 +10,83 @@ namespace photos_editing_formats {
 namespace image_io {
 
 /// A helper class for building information about the segments that contain
-/// extended xmp data of various types.
+/// extended xmp data of various types. Each extended xmp segment holds a chunk
+/// of a larger xmp packet, and its header records the packet's full length and
+/// the chunk's offset in it. The builder uses these values to put the chunks in
+/// packet order, so the segments need not appear in the file in that order.
 class JpegXmpInfoBuilder {
  public:
   /// @param xmp_info_type The type of xmp information to build.
   explicit JpegXmpInfoBuilder(JpegXmpInfo::Type xmp_info_type)
-      : xmp_info_type_(xmp_info_type) {}
+      : xmp_info_type_(xmp_info_type), has_value_begin_(false) {}
 
   /// @param segment The segment to examine for xmp data.
   void ProcessSegment(const JpegSegment& segment);
 
+  /// Reassembles the chunks of the segments passed to ProcessSegment() and
+  /// computes the property segment and value ranges. Call this function after
+  /// the last segment has been processed.
+  void Finish();
+
   /// @return The vector of segment data ranges that contains xmp property data.
   const std::vector<DataRange>& GetPropertySegmentRanges() const {
     return property_segment_ranges_;
   }
 
+  /// @return The vector of data ranges of the xmp property value, in the order
+  ///     in which they form the value, or an empty vector if the value was not
+  ///     found in the chunks.
+  const std::vector<DataRange>& GetPropertyValueRanges() const {
+    return property_value_ranges_;
+  }
+
  private:
+  /// The information about an extended xmp segment's chunk of the xmp packet.
+  /// The locations of the property value's begin and end are relative to the
+  /// start of the chunk data, and equal the chunk size if not in the chunk.
+  struct Chunk {
+    /// The data range of the segment.
+    DataRange segment_range;
+
+    /// The location in the file of the first byte of the chunk data.
+    size_t data_location;
+
+    /// The number of bytes of chunk data.
+    size_t size;
+
+    /// The full length of the xmp packet recorded in the segment.
+    size_t full_length;
+
+    /// The offset of the chunk data in the xmp packet.
+    size_t offset;
+
+    /// The offset in the chunk of the first byte of the property value.
+    size_t value_begin;
+
+    /// The offset in the chunk of the first quote that follows value_begin if
+    /// the chunk has the value's begin, or of the first quote in the chunk.
+    size_t quote;
+  };
+
+  /// @param chunks The chunks to check, sorted by their offsets.
+  /// @return True if the chunks' offsets fit together to form an xmp packet
+  ///     with no gaps or overlaps.
+  static bool HaveConsistentChunkOffsets(const std::vector<Chunk>& chunks);
+
   /// The type of xmp data to collect.
   JpegXmpInfo::Type xmp_info_type_;
 
+  /// The chunks of the segments, in the order they were processed.
+  std::vector<Chunk> chunks_;
+
+  /// Whether the begin of the property value was found in one of the chunks.
+  bool has_value_begin_;
+
   /// The vector of segment data ranges that contains xmp property data.
   std::vector<DataRange> property_segment_ranges_;
 
-  /// The segment data range that contains the xmp property data end.
-  DataRange property_end_segment_range_;
+  /// The vector of data ranges of the xmp property value.
+  std::vector<DataRange> property_value_ranges_;
 };
 
 }  // namespace image_io
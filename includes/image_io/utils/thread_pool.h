@@ -0,0 +1,97 @@
+#ifndef IMAGE_IO_UTILS_THREAD_POOL_H_  // NOLINT
+#define IMAGE_IO_UTILS_THREAD_POOL_H_  // NOLINT
+
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// A pool of worker threads that run tasks. Each worker has its own queue of
+/// tasks; Submit() distributes the tasks over the queues round robin, and a
+/// worker that runs out of tasks in its own queue steals tasks from the other
+/// queues, so the load stays balanced when the tasks take different amounts of
+/// time. A worker takes tasks from the back of its own queue and steals from
+/// the front of the others. Each task is passed the index of the worker that
+/// runs it, so that clients can keep expensive per-worker objects (scanners,
+/// buffers, message handlers and the like) in a vector indexed by it.
+class ThreadPool {
+ public:
+  /// The function type of the tasks run by the pool.
+  /// @param worker_index The index of the worker running the task, in the range
+  ///     [0:GetThreadCount()).
+  using Task = std::function<void(size_t worker_index)>;
+
+  /// @param thread_count The number of worker threads to create. If zero, the
+  ///     number of hardware threads is used (or 1 if that is unknown).
+  explicit ThreadPool(size_t thread_count);
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// Waits for the submitted tasks to finish, and stops the worker threads.
+  ~ThreadPool();
+
+  /// @return The number of worker threads in the pool.
+  size_t GetThreadCount() const { return threads_.size(); }
+
+  /// Adds a task to be run by one of the worker threads.
+  /// @param task The task to run.
+  void Submit(Task task);
+
+  /// Waits until all the tasks submitted so far have finished running.
+  void Wait();
+
+ private:
+  /// The queue of tasks of one worker thread.
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  /// The function run by the worker threads.
+  /// @param worker_index The index of the worker.
+  void RunWorker(size_t worker_index);
+
+  /// Removes a task from the worker's own queue, or steals one from another.
+  /// @param worker_index The index of the worker looking for a task.
+  /// @param task Receives the task.
+  /// @return Whether a task was found.
+  bool TakeTask(size_t worker_index, Task* task);
+
+  /// The task queues, one per worker thread.
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+
+  /// The worker threads.
+  std::vector<std::thread> threads_;
+
+  /// The mutex that guards the counts and flags below.
+  std::mutex mutex_;
+
+  /// Signaled when a task is submitted, or when the pool is stopping.
+  std::condition_variable task_available_;
+
+  /// Signaled when the last unfinished task finishes.
+  std::condition_variable tasks_finished_;
+
+  /// The number of tasks waiting in the queues.
+  size_t queued_task_count_;
+
+  /// The number of tasks submitted that have not yet finished.
+  size_t unfinished_task_count_;
+
+  /// The queue to which the next submitted task is added.
+  size_t next_queue_index_;
+
+  /// Whether the worker threads should stop once the queues are empty.
+  bool is_stopping_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_UTILS_THREAD_POOL_H_  // NOLINT
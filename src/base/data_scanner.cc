@@ -1,5 +1,15 @@
 #include "image_io/base/data_scanner.h"
 
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMAGE_IO_DATA_SCANNER_X86 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGE_IO_DATA_SCANNER_NEON 1
+#endif
+
 namespace photos_editing_formats {
 namespace image_io {
 
@@ -7,50 +17,209 @@ namespace {
 
 const char kWhitespaceChars[] = " \t\n\r";
 
-/// This function is like strspn but does not assume a null-terminated string.
-size_t memspn(const char* s, size_t slen, const char* accept) {
-  const char* p = s;
-  const char* spanp;
-  char c, sc;
+/// The characters that can begin a name, and those that can follow them.
+const char kFirstNameChars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_:";
+const char kNameChars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.-_:";
+
+/// A set of characters, held both as a 256 entry table for the scalar code and
+/// as a pair of 16 entry nibble tables for the vector code. A character is in
+/// the set if the entries of its low and high nibbles have a bit in common.
+/// The nibble tables are built by giving each distinct set of low nibbles that
+/// occur with a high nibble its own bit, so they are exact for any set in which
+/// there are at most 8 such distinct sets, as is the case for the name and the
+/// whitespace characters.
+class CharClass {
+ public:
+  /// @param chars The null terminated characters of the set.
+  explicit CharClass(const char* chars) : has_nibble_bits_(true) {
+    std::memset(contains_, 0, sizeof(contains_));
+    std::memset(low_nibble_bits_, 0, sizeof(low_nibble_bits_));
+    std::memset(high_nibble_bits_, 0, sizeof(high_nibble_bits_));
+    for (const char* cptr = chars; *cptr; ++cptr) {
+      contains_[static_cast<Byte>(*cptr)] = true;
+    }
+    unsigned int low_nibble_sets[8];
+    size_t low_nibble_set_count = 0;
+    for (unsigned int high = 0; high < 16; ++high) {
+      unsigned int low_nibble_set = 0;
+      for (unsigned int low = 0; low < 16; ++low) {
+        if (contains_[high << 4 | low]) {
+          low_nibble_set |= 1U << low;
+        }
+      }
+      if (low_nibble_set == 0) {
+        continue;
+      }
+      size_t bit = 0;
+      while (bit < low_nibble_set_count &&
+             low_nibble_sets[bit] != low_nibble_set) {
+        ++bit;
+      }
+      if (bit == 8) {
+        has_nibble_bits_ = false;
+        return;
+      }
+      if (bit == low_nibble_set_count) {
+        low_nibble_sets[low_nibble_set_count++] = low_nibble_set;
+        for (unsigned int low = 0; low < 16; ++low) {
+          if (low_nibble_set & (1U << low)) {
+            low_nibble_bits_[low] |= static_cast<Byte>(1U << bit);
+          }
+        }
+      }
+      high_nibble_bits_[high] = static_cast<Byte>(1U << bit);
+    }
+  }
+
+  /// @return Whether the character is in the set.
+  bool Contains(char value) const {
+    return contains_[static_cast<Byte>(value)];
+  }
+
+  /// @return Whether the nibble tables represent the set, and so can be used
+  ///     by the vector code.
+  bool HasNibbleBits() const { return has_nibble_bits_; }
+  const Byte* GetLowNibbleBits() const { return low_nibble_bits_; }
+  const Byte* GetHighNibbleBits() const { return high_nibble_bits_; }
+
+ private:
+  bool contains_[256];
+  alignas(16) Byte low_nibble_bits_[16];
+  alignas(16) Byte high_nibble_bits_[16];
+  bool has_nibble_bits_;
+};
+
+/// The signature of the functions that scan the leading characters of a buffer
+/// that are in a character class with vector instructions.
+/// @param char_class The character class, whose nibble tables must be valid.
+/// @param s The characters to scan.
+/// @param slen The number of characters to scan.
+/// @return A number of leading characters that are all in the class, a multiple
+///     of 16. The scan stops at the first block of 16 characters that holds one
+///     that is not in the class, or that is not complete.
+using VectorSpanFunction = size_t (*)(const CharClass& char_class,
+                                      const char* s, size_t slen);
+
+#if IMAGE_IO_DATA_SCANNER_X86
+
+/// Scans 16 characters at a time using SSSE3 instructions.
+__attribute__((target("ssse3"))) size_t SpanSsse3(const CharClass& char_class,
+                                                  const char* s, size_t slen) {
+  const __m128i kLowNibbleLut = _mm_load_si128(
+      reinterpret_cast<const __m128i*>(char_class.GetLowNibbleBits()));
+  const __m128i kHighNibbleLut = _mm_load_si128(
+      reinterpret_cast<const __m128i*>(char_class.GetHighNibbleBits()));
+  const __m128i k0F = _mm_set1_epi8(0x0F);
+  const __m128i k00 = _mm_setzero_si128();
+  size_t index = 0;
+  for (; index + 16 <= slen; index += 16) {
+    __m128i chars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + index));
+    __m128i low_bits =
+        _mm_shuffle_epi8(kLowNibbleLut, _mm_and_si128(chars, k0F));
+    __m128i high_bits = _mm_shuffle_epi8(
+        kHighNibbleLut, _mm_and_si128(_mm_srli_epi16(chars, 4), k0F));
+    __m128i is_outside =
+        _mm_cmpeq_epi8(_mm_and_si128(low_bits, high_bits), k00);
+    if (_mm_movemask_epi8(is_outside) != 0) {
+      break;
+    }
+  }
+  return index;
+}
 
-cont:
-  c = *p++;
-  if (slen-- == 0) return p - 1 - s;
-  for (spanp = accept; (sc = *spanp++) != '\0';)
-    if (sc == c) goto cont;
-  return p - 1 - s;
+#elif IMAGE_IO_DATA_SCANNER_NEON
+
+/// Scans 16 characters at a time using NEON instructions.
+size_t SpanNeon(const CharClass& char_class, const char* s, size_t slen) {
+  const uint8x16_t kLowNibbleLut = vld1q_u8(char_class.GetLowNibbleBits());
+  const uint8x16_t kHighNibbleLut = vld1q_u8(char_class.GetHighNibbleBits());
+  const uint8x16_t k0F = vdupq_n_u8(0x0F);
+  size_t index = 0;
+  for (; index + 16 <= slen; index += 16) {
+    uint8x16_t chars = vld1q_u8(reinterpret_cast<const uint8_t*>(s + index));
+    uint8x16_t low_bits = vqtbl1q_u8(kLowNibbleLut, vandq_u8(chars, k0F));
+    uint8x16_t high_bits = vqtbl1q_u8(kHighNibbleLut, vshrq_n_u8(chars, 4));
+    if (vminvq_u8(vtstq_u8(low_bits, high_bits)) == 0) {
+      break;
+    }
+  }
+  return index;
 }
 
-/// @return Whether value is in the range [lo:hi].
-bool InRange(char value, char lo, char hi) {
-  return value >= lo && value <= hi;
+#endif
+
+/// @return The best vector span function for the processor this code is running
+///     on, or nullptr if there is none.
+VectorSpanFunction SelectVectorSpanFunction() {
+#if IMAGE_IO_DATA_SCANNER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) {
+    return SpanSsse3;
+  }
+#elif IMAGE_IO_DATA_SCANNER_NEON
+  return SpanNeon;
+#endif
+  return nullptr;
 }
 
-/// @return Whether the value is the first character of a kName type scanner.
-bool IsFirstNameChar(char value) {
-  return InRange(value, 'A', 'Z') || InRange(value, 'a', 'z') || value == '_' ||
-         value == ':';
+/// @return The vector span function, selected the first time this function is
+///     called.
+VectorSpanFunction GetVectorSpanFunction() {
+  static const VectorSpanFunction vector_span = SelectVectorSpanFunction();
+  return vector_span;
 }
 
-/// Scans the characters in the s string, where the characters can be any legal
-/// character in the name.
-/// @return The number of name characters scanned.
-size_t ScanOptionalNameChars(const char* s, size_t slen) {
-  const char* kOptionalChars =
-      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.-_:";
-  return memspn(s, slen, kOptionalChars);
+/// This function is like strspn but does not assume a null-terminated string,
+/// and takes the accepted characters as a CharClass. Long spans are scanned 16
+/// characters at a time with the vector span function, and the remainder with
+/// a table lookup per character.
+/// @return The number of leading characters of s that are in the class.
+size_t memspn(const char* s, size_t slen, const CharClass& char_class) {
+  size_t index = 0;
+  VectorSpanFunction vector_span = GetVectorSpanFunction();
+  if (vector_span && slen >= 16 && char_class.HasNibbleBits()) {
+    index = vector_span(char_class, s, slen);
+  }
+  while (index < slen && char_class.Contains(s[index])) {
+    ++index;
+  }
+  return index;
 }
 
-/// Scans the whitespace characters in the s string.
-/// @return The number of whitepace characters scanned.
-size_t ScanWhitespaceChars(const char* s, size_t slen) {
-  return memspn(s, slen, kWhitespaceChars);
+/// @return The character classes used by the scanners, built the first time
+///     the functions are called.
+const CharClass& GetFirstNameCharClass() {
+  static const CharClass first_name_char_class(kFirstNameChars);
+  return first_name_char_class;
+}
+const CharClass& GetNameCharClass() {
+  static const CharClass name_char_class(kNameChars);
+  return name_char_class;
+}
+const CharClass& GetWhitespaceCharClass() {
+  static const CharClass whitespace_char_class(kWhitespaceChars);
+  return whitespace_char_class;
 }
 
 }  // namespace
 
 std::string DataScanner::GetWhitespaceChars() { return kWhitespaceChars; }
 
+bool DataScanner::IsFirstNameChar(char value) {
+  return GetFirstNameCharClass().Contains(value);
+}
+
+size_t DataScanner::SpanNameChars(const char* s, size_t slen) {
+  return memspn(s, slen, GetNameCharClass());
+}
+
+size_t DataScanner::SpanWhitespaceChars(const char* s, size_t slen) {
+  return memspn(s, slen, GetWhitespaceCharClass());
+}
+
 DataScanner DataScanner::CreateLiteralScanner(const std::string& literal) {
   return DataScanner(DataScanner::kLiteral, literal);
 }
@@ -142,8 +311,7 @@ DataMatchResult DataScanner::ScanName(const char* cbytes,
     bytes_available -= 1;
     cbytes += 1;
   }
-  size_t optional_bytes_consumed =
-      ScanOptionalNameChars(cbytes, bytes_available);
+  size_t optional_bytes_consumed = SpanNameChars(cbytes, bytes_available);
   token_length = ExtendTokenLength(optional_bytes_consumed);
   result.IncrementBytesConsumed(optional_bytes_consumed);
   if (result.GetBytesConsumed() == 0 && token_length > 0) {
@@ -277,7 +445,7 @@ DataMatchResult DataScanner::ScanWhitespace(const char* cbytes,
                                             const DataContext& context) {
   DataMatchResult result;
   size_t token_length = token_range_.GetLength();
-  result.SetBytesConsumed(ScanWhitespaceChars(cbytes, bytes_available));
+  result.SetBytesConsumed(SpanWhitespaceChars(cbytes, bytes_available));
   token_length = ExtendTokenLength(result.GetBytesConsumed());
   if (result.GetBytesConsumed() == 0) {
     if (token_length == 0 && type_ == kWhitespace) {
@@ -1,6 +1,9 @@
 #include "image_io/base/data_segment.h"
 
 #include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
 
 namespace photos_editing_formats {
 namespace image_io {
@@ -8,6 +11,70 @@ namespace image_io {
 using std::default_delete;
 using std::shared_ptr;
 
+namespace {
+
+/// An allocator for std::allocate_shared() that appends a buffer of a given
+/// size to the memory it allocates for the shared pointer's control block and
+/// object, so that all three are allocated together.
+template <class T>
+class InlineBufferAllocator {
+ public:
+  using value_type = T;
+
+  /// @param buffer_size The size of the buffer to append.
+  /// @param buffer Receives the location of the buffer when memory is
+  ///     allocated.
+  InlineBufferAllocator(size_t buffer_size, Byte** buffer)
+      : buffer_size_(buffer_size), buffer_(buffer) {}
+
+  template <class U>
+  InlineBufferAllocator(const InlineBufferAllocator<U>& other)  // NOLINT
+      : buffer_size_(other.buffer_size_), buffer_(other.buffer_) {}
+
+  T* allocate(size_t count) {
+    size_t size = count * sizeof(T);
+    Byte* memory = static_cast<Byte*>(::operator new(size + buffer_size_));
+    *buffer_ = memory + size;
+    return reinterpret_cast<T*>(memory);
+  }
+
+  void deallocate(T* memory, size_t /* count */) { ::operator delete(memory); }
+
+  template <class U>
+  bool operator==(const InlineBufferAllocator<U>& other) const {
+    return buffer_size_ == other.buffer_size_ && buffer_ == other.buffer_;
+  }
+
+  template <class U>
+  bool operator!=(const InlineBufferAllocator<U>& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  template <class U>
+  friend class InlineBufferAllocator;
+
+  size_t buffer_size_;
+  Byte** buffer_;
+};
+
+}  // namespace
+
+/// Since this class is nested in DataSegment, it can use the private
+/// constructor and destructor of its base class, while std::allocate_shared()
+/// can use its own public ones.
+class DataSegment::InlineBufferDataSegment : public DataSegment {
+ public:
+  /// @param data_range The data range of the data segment.
+  /// @param buffer The location of the buffer allocated after the data
+  ///     segment, which is only known once the memory has been allocated.
+  InlineBufferDataSegment(const DataRange& data_range, Byte* const* buffer)
+      : DataSegment(data_range, *buffer,
+                    BufferDispositionPolicy::kDontDelete) {
+    owns_buffer_ = true;
+  }
+};
+
 shared_ptr<DataSegment> DataSegment::Create(
     const DataRange& data_range, const Byte* buffer,
     DataSegment::BufferDispositionPolicy buffer_policy) {
@@ -16,6 +83,41 @@ shared_ptr<DataSegment> DataSegment::Create(
       default_delete<DataSegment>());
 }
 
+shared_ptr<DataSegment> DataSegment::Create(
+    const DataRange& data_range, const Byte* buffer,
+    shared_ptr<const void> buffer_owner) {
+  shared_ptr<DataSegment> data_segment =
+      Create(data_range, buffer, BufferDispositionPolicy::kDontDelete);
+  data_segment->owns_buffer_ = buffer_owner != nullptr;
+  data_segment->buffer_owner_ = std::move(buffer_owner);
+  return data_segment;
+}
+
+shared_ptr<DataSegment> DataSegment::CreateWithBuffer(
+    const DataRange& data_range, Byte** buffer) {
+  // The allocator sets the buffer location before the segment is constructed.
+  Byte* inline_buffer = nullptr;
+  InlineBufferAllocator<InlineBufferDataSegment> allocator(
+      data_range.GetLength(), &inline_buffer);
+  auto segment = std::allocate_shared<InlineBufferDataSegment>(
+      allocator, data_range, &inline_buffer);
+  *buffer = inline_buffer;
+  return segment;
+}
+
+shared_ptr<DataSegment> DataSegment::CreateView(
+    const shared_ptr<const DataSegment>& parent, const DataRange& sub_range) {
+  if (!parent || !parent->GetDataRange().Contains(sub_range)) {
+    return nullptr;
+  }
+  shared_ptr<DataSegment> view =
+      Create(sub_range, parent->GetBuffer(sub_range.GetBegin()),
+             BufferDispositionPolicy::kDontDelete);
+  view->owns_buffer_ = parent->OwnsBuffer();
+  view->buffer_owner_ = parent;
+  return view;
+}
+
 size_t DataSegment::Find(size_t start_location, Byte value) const {
   if (!Contains(start_location)) {
     return GetEnd();
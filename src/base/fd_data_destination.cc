@@ -0,0 +1,266 @@
+#include "image_io/base/fd_data_destination.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include "image_io/base/data_range.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+namespace {
+
+/// The size of the buffer holding the copies of the small ranges.
+const size_t kCopyBufferSize = 0x10000;
+
+/// The maximum number of ranges to pass to a single writev(2) call.
+#ifdef IOV_MAX
+const size_t kMaxWriteRangeCount = IOV_MAX;
+#else
+const size_t kMaxWriteRangeCount = 1024;
+#endif
+
+/// The maximum number of bytes to copy with a single system call, which keeps
+/// the counts well within the range of the ssize_t return values.
+const size_t kMaxFileCopySize = 0x40000000;
+
+// Older Android releases kill processes that make system calls missing from
+// their seccomp policy, so copy_file_range(2) is only used if the platform is
+// known to allow it.
+#if defined(__linux__) && defined(__NR_copy_file_range) && \
+    (!defined(__ANDROID__) || __ANDROID_API__ >= 34)
+#define IMAGE_IO_HAS_COPY_FILE_RANGE 1
+#endif
+
+/// @param error The errno value set by a failed file copy system call.
+/// @return Whether the error means that the files do not support the system
+///     call, as opposed to an error reading or writing them.
+bool IsUnsupportedCopyError(int error) {
+  return error == ENOSYS || error == EINVAL || error == EXDEV ||
+         error == EOPNOTSUPP || error == EBADF;
+}
+
+}  // namespace
+
+FdDataDestination::FdDataDestination(int fd, size_t flush_byte_threshold,
+                                     size_t flush_range_threshold,
+                                     MessageHandler* message_handler)
+    : fd_(fd),
+      flush_byte_threshold_(flush_byte_threshold),
+      flush_range_threshold_(
+          std::min(std::max<size_t>(flush_range_threshold, 1),
+                   kMaxWriteRangeCount)),
+      message_handler_(message_handler),
+      queued_byte_count_(0),
+      copy_buffer_(new Byte[kCopyBufferSize]),  // NOLINT
+      copy_buffer_size_(0),
+      bytes_transferred_(0),
+      write_call_count_(0),
+#if defined(IMAGE_IO_HAS_COPY_FILE_RANGE)
+      file_copy_method_(kCopyFileRange),
+#elif defined(__linux__)
+      file_copy_method_(kSendFile),
+#else
+      file_copy_method_(kReadWrite),
+#endif
+      has_error_(false) {
+  queued_ranges_.reserve(flush_range_threshold_);
+}
+
+FdDataDestination::~FdDataDestination() { Flush(); }
+
+void FdDataDestination::StartTransfer() {}
+
+DataDestination::TransferStatus FdDataDestination::Transfer(
+    const DataRange& transfer_range, const DataSegment& data_segment) {
+  if (has_error_) {
+    return kTransferError;
+  }
+  if (!transfer_range.IsValid()) {
+    return kTransferOk;
+  }
+  const Byte* buffer = data_segment.GetBuffer(transfer_range.GetBegin());
+  size_t size = transfer_range.GetLength();
+  if (!buffer || !data_segment.Contains(transfer_range.GetEnd() - 1)) {
+    if (message_handler_) {
+      message_handler_->ReportMessage(Message::kStdLibError, name_);
+    }
+    has_error_ = true;
+    return kTransferError;
+  }
+
+  bool must_flush = false;
+  if (size <= kMaxCopySize) {
+    // The range is copied to the copy buffer, which must first be written if
+    // it is full, since the queued ranges may refer to its bytes.
+    if (copy_buffer_size_ + size > kCopyBufferSize && !Flush()) {
+      return kTransferError;
+    }
+    Byte* copy = &copy_buffer_[copy_buffer_size_];
+    std::memcpy(copy, buffer, size);
+    copy_buffer_size_ += size;
+    Enqueue(copy, size);
+  } else {
+    // A segment that owns its buffer is kept alive until its bytes have been
+    // written; the bytes of any other segment must be written right away.
+    std::shared_ptr<const DataSegment> shared_segment;
+    if (data_segment.OwnsBuffer()) {
+      shared_segment = data_segment.weak_from_this().lock();
+    }
+    if (shared_segment) {
+      if (queued_data_segments_.empty() ||
+          queued_data_segments_.back() != shared_segment) {
+        queued_data_segments_.push_back(shared_segment);
+      }
+    } else {
+      must_flush = true;
+    }
+    Enqueue(buffer, size);
+  }
+  bytes_transferred_ += size;
+
+  if (must_flush || queued_byte_count_ >= flush_byte_threshold_ ||
+      queued_ranges_.size() >= flush_range_threshold_) {
+    if (!Flush()) {
+      return kTransferError;
+    }
+  }
+  return kTransferOk;
+}
+
+void FdDataDestination::FinishTransfer() { Flush(); }
+
+DataDestination::TransferStatus FdDataDestination::TransferFromFile(
+    int fd, const DataRange& transfer_range) {
+  // The queued bytes are written first, to keep the bytes in order.
+  if (has_error_ || !Flush()) {
+    return kTransferError;
+  }
+  size_t begin = transfer_range.GetBegin();
+  size_t end = transfer_range.IsValid() ? transfer_range.GetEnd() : begin;
+  while (begin < end) {
+    ssize_t bytes_copied =
+        CopyFromFile(fd, begin, std::min(end - begin, kMaxFileCopySize));
+    if (bytes_copied < 0 && errno == EINTR) {
+      continue;
+    }
+    if (bytes_copied < 0 && file_copy_method_ != kReadWrite &&
+        IsUnsupportedCopyError(errno)) {
+      file_copy_method_ = file_copy_method_ == kCopyFileRange ? kSendFile
+                                                              : kReadWrite;
+      continue;
+    }
+    if (bytes_copied < 0) {
+      // A failed write of the read/write method has already been reported.
+      if (message_handler_ && !has_error_) {
+        message_handler_->ReportMessage(Message::kStdLibError, name_);
+      }
+      has_error_ = true;
+      return kTransferError;
+    }
+    if (bytes_copied == 0) {
+      break;
+    }
+    begin += static_cast<size_t>(bytes_copied);
+    bytes_transferred_ += static_cast<size_t>(bytes_copied);
+  }
+  return kTransferOk;
+}
+
+ssize_t FdDataDestination::CopyFromFile(int fd, size_t begin, size_t count) {
+#if defined(IMAGE_IO_HAS_COPY_FILE_RANGE)
+  if (file_copy_method_ == kCopyFileRange) {
+    ++write_call_count_;
+    loff_t offset = static_cast<loff_t>(begin);
+    return syscall(__NR_copy_file_range, fd, &offset, fd_, nullptr, count, 0);
+  }
+#endif
+#if defined(__linux__)
+  if (file_copy_method_ == kSendFile) {
+    ++write_call_count_;
+    off_t offset = static_cast<off_t>(begin);
+    return sendfile(fd_, fd, &offset, count);
+  }
+#endif
+  // The bytes are read into the (empty) copy buffer, and written from there.
+  ssize_t bytes_read = pread(fd, copy_buffer_.get(),
+                             std::min(count, kCopyBufferSize),
+                             static_cast<off_t>(begin));
+  if (bytes_read > 0) {
+    Enqueue(copy_buffer_.get(), static_cast<size_t>(bytes_read));
+    if (!Flush()) {
+      errno = EIO;
+      return -1;
+    }
+  }
+  return bytes_read;
+}
+
+void FdDataDestination::Enqueue(const Byte* bytes, size_t size) {
+  if (!queued_ranges_.empty()) {
+    iovec& last_range = queued_ranges_.back();
+    if (static_cast<const Byte*>(last_range.iov_base) + last_range.iov_len ==
+        bytes) {
+      last_range.iov_len += size;
+      queued_byte_count_ += size;
+      return;
+    }
+  }
+  iovec range;
+  range.iov_base = const_cast<Byte*>(bytes);
+  range.iov_len = size;
+  queued_ranges_.push_back(range);
+  queued_byte_count_ += size;
+}
+
+bool FdDataDestination::Flush() {
+  size_t range_index = 0;
+  size_t range_count = queued_ranges_.size();
+  while (!has_error_ && range_index < range_count) {
+    size_t write_range_count =
+        std::min(range_count - range_index, kMaxWriteRangeCount);
+    ssize_t bytes_written =
+        writev(fd_, &queued_ranges_[range_index],
+               static_cast<int>(write_range_count));
+    ++write_call_count_;
+    if (bytes_written < 0) {
+      if (errno != EINTR) {
+        if (message_handler_) {
+          message_handler_->ReportMessage(Message::kStdLibError, name_);
+        }
+        has_error_ = true;
+      }
+      continue;
+    }
+    // Skip the ranges that were written completely, and adjust the first one
+    // that was not, if any, for the next writev(2) call.
+    size_t bytes_left = static_cast<size_t>(bytes_written);
+    while (range_index < range_count &&
+           queued_ranges_[range_index].iov_len <= bytes_left) {
+      bytes_left -= queued_ranges_[range_index].iov_len;
+      ++range_index;
+    }
+    if (bytes_left > 0) {
+      iovec& range = queued_ranges_[range_index];
+      range.iov_base = static_cast<Byte*>(range.iov_base) + bytes_left;
+      range.iov_len -= bytes_left;
+    }
+  }
+  queued_ranges_.clear();
+  queued_data_segments_.clear();
+  queued_byte_count_ = 0;
+  copy_buffer_size_ = 0;
+  return !has_error_;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
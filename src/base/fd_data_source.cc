@@ -0,0 +1,193 @@
+#include "image_io/base/fd_data_source.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "image_io/base/data_destination.h"
+#include "image_io/base/data_segment.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::shared_ptr;
+using std::unique_ptr;
+
+constexpr size_t FdDataSource::kDefaultMaxPooledBufferCount;
+
+/// A thread safe pool of byte buffers. Buffers are handed out by Acquire() and
+/// given back by Release(); released buffers are kept (up to a limit) so that
+/// later Acquire() calls of the same or smaller size can reuse them.
+class FdDataSource::BufferPool {
+ public:
+  /// A buffer and its capacity.
+  struct Buffer {
+    Buffer() : capacity(0) {}
+    Buffer(unique_ptr<Byte[]> a_bytes, size_t a_capacity)
+        : bytes(std::move(a_bytes)), capacity(a_capacity) {}
+    unique_ptr<Byte[]> bytes;
+    size_t capacity;
+  };
+
+  /// The object that owns a pooled buffer on behalf of a DataSegment. The
+  /// shared pointers returned to clients of FdDataSource share ownership with
+  /// this object so the buffer goes back to the pool when the last of them is
+  /// released.
+  struct PooledDataSegment {
+    PooledDataSegment(shared_ptr<BufferPool> a_pool, Buffer a_buffer)
+        : pool(std::move(a_pool)), buffer(std::move(a_buffer)) {}
+    ~PooledDataSegment() {
+      data_segment.reset();
+      pool->Release(std::move(buffer));
+    }
+    shared_ptr<BufferPool> pool;
+    Buffer buffer;
+    shared_ptr<DataSegment> data_segment;
+  };
+
+  explicit BufferPool(size_t max_buffer_count)
+      : max_buffer_count_(max_buffer_count) {}
+
+  /// @param size The minimum size of the buffer.
+  /// @return A pooled buffer at least size bytes long, or a new one.
+  Buffer Acquire(size_t size) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (auto iter = buffers_.begin(); iter != buffers_.end(); ++iter) {
+        if (iter->capacity >= size) {
+          Buffer buffer = std::move(*iter);
+          buffers_.erase(iter);
+          return buffer;
+        }
+      }
+    }
+    return Buffer(unique_ptr<Byte[]>(new Byte[size]), size);  // NOLINT
+  }
+
+  /// @param buffer The buffer to return to the pool. If the pool is full, the
+  ///     smallest buffer in the pool (possibly this one) is deleted.
+  void Release(Buffer buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffers_.size() < max_buffer_count_) {
+      buffers_.push_back(std::move(buffer));
+      return;
+    }
+    for (auto& pooled_buffer : buffers_) {
+      if (pooled_buffer.capacity < buffer.capacity) {
+        std::swap(pooled_buffer, buffer);
+      }
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  size_t max_buffer_count_;
+  std::vector<Buffer> buffers_;
+};
+
+FdDataSource::FdDataSource(int fd, size_t max_pooled_buffer_count,
+                           MessageHandler* message_handler)
+    : fd_(fd),
+      message_handler_(message_handler),
+      buffer_pool_(new BufferPool(max_pooled_buffer_count)) {}
+
+void FdDataSource::Reset() {}
+
+std::shared_ptr<DataSegment> FdDataSource::GetDataSegment(size_t begin,
+                                                          size_t min_size) {
+  return Read(begin, min_size);
+}
+
+DataSource::TransferDataResult FdDataSource::TransferData(
+    const DataRange& data_range, size_t best_size,
+    DataDestination* data_destination) {
+  bool data_transferred = false;
+  DataDestination::TransferStatus status = DataDestination::kTransferDone;
+  if (data_destination && data_range.IsValid() && fd_ >= 0 &&
+      data_destination->CanTransferFromFile()) {
+    size_t old_byte_count = data_destination->GetBytesTransferred();
+    status = data_destination->TransferFromFile(fd_, data_range);
+    data_transferred =
+        data_destination->GetBytesTransferred() != old_byte_count ||
+        status == DataDestination::kTransferError;
+  } else if (data_destination && data_range.IsValid()) {
+    size_t chunk_size = std::min(data_range.GetLength(), best_size);
+    for (size_t begin = data_range.GetBegin(); begin < data_range.GetEnd();
+         begin += chunk_size) {
+      size_t segment_length = 0;
+      size_t end = std::min(data_range.GetEnd(), begin + chunk_size);
+      std::shared_ptr<DataSegment> data_segment = Read(begin, end - begin);
+      if (data_segment) {
+        segment_length = data_segment->GetLength();
+        status = data_destination->Transfer(data_segment->GetDataRange(),
+                                            *data_segment);
+        data_transferred = true;
+      }
+      if (status != DataDestination::kTransferOk || segment_length == 0) {
+        break;
+      }
+    }
+  }
+  if (data_transferred) {
+    return status == DataDestination::kTransferError ? kTransferDataError
+                                                     : kTransferDataSuccess;
+  } else {
+    return data_destination ? kTransferDataNone : kTransferDataError;
+  }
+}
+
+std::shared_ptr<DataSegment> FdDataSource::Read(size_t begin, size_t count) {
+  if (fd_ < 0 || count == 0) {
+    return nullptr;
+  }
+  // The locations are passed to pread() as off_t values, which may be smaller
+  // than size_t (e.g., 32 bits on 32 bit Android builds), so the bytes beyond
+  // the largest off_t value can not be read.
+  constexpr uint64_t kMaxOffset = std::numeric_limits<off_t>::max();
+  if (uint64_t{begin} >= kMaxOffset) {
+    errno = EOVERFLOW;
+    if (message_handler_) {
+      message_handler_->ReportMessage(Message::kStdLibError, name_);
+    }
+    return nullptr;
+  }
+  count = static_cast<size_t>(
+      std::min(uint64_t{count}, kMaxOffset - uint64_t{begin}));
+  auto holder = std::make_shared<BufferPool::PooledDataSegment>(
+      buffer_pool_, buffer_pool_->Acquire(count));
+  Byte* buffer = holder->buffer.bytes.get();
+  size_t bytes_read = 0;
+  while (bytes_read < count) {
+    ssize_t result = pread(fd_, buffer + bytes_read, count - bytes_read,
+                           static_cast<off_t>(begin + bytes_read));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      if (message_handler_) {
+        message_handler_->ReportMessage(Message::kStdLibError, name_);
+      }
+      return nullptr;
+    }
+    if (result == 0) {
+      break;
+    }
+    bytes_read += static_cast<size_t>(result);
+  }
+  if (bytes_read == 0) {
+    return nullptr;
+  }
+  holder->data_segment =
+      DataSegment::Create(DataRange(begin, begin + bytes_read), buffer,
+                          DataSegment::BufferDispositionPolicy::kDontDelete);
+  return shared_ptr<DataSegment>(holder, holder->data_segment.get());
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -68,11 +68,17 @@ std::shared_ptr<DataSegment> IStreamRefDataSource::Read(size_t begin,
   std::shared_ptr<DataSegment> shared_data_segment;
   istream_ref_.seekg(begin);
   if (istream_ref_.rdstate() == std::ios_base::goodbit) {
-    Byte *buffer = new Byte[count];
+    Byte *buffer = nullptr;
+    shared_data_segment = SegmentAllocator::CreateDataSegment(
+        segment_allocator_, DataRange(begin, begin + count), &buffer);
     istream_ref_.read(reinterpret_cast<char *>(buffer), count);
     size_t bytes_read = istream_ref_.gcount();
-    shared_data_segment =
-        DataSegment::Create(DataRange(begin, begin + bytes_read), buffer);
+    if (bytes_read != count) {
+      // A view is returned for a short read at the end of the stream, or a
+      // nullptr if no bytes were read at all.
+      shared_data_segment = DataSegment::CreateView(
+          shared_data_segment, DataRange(begin, begin + bytes_read));
+    }
   }
   return shared_data_segment;
 }
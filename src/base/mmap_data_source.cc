@@ -0,0 +1,71 @@
+#include "image_io/base/mmap_data_source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "image_io/base/data_destination.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+MmapDataSource::MmapDataSource(const std::string& file_name,
+                               MessageHandler* message_handler)
+    : mapped_address_(nullptr), mapped_size_(0) {
+  int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd >= 0) {
+    struct stat stat_buf;
+    if (fstat(fd, &stat_buf) == 0 && stat_buf.st_size > 0) {
+      size_t size = static_cast<size_t>(stat_buf.st_size);
+      void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address != MAP_FAILED) {
+        mapped_address_ = address;
+        mapped_size_ = size;
+        // The scanner and the transfer functions walk the file front to back.
+        madvise(mapped_address_, mapped_size_, MADV_SEQUENTIAL);
+      }
+    }
+    // The mapping remains valid after the file descriptor is closed.
+    close(fd);
+  }
+  if (!mapped_address_) {
+    if (message_handler) {
+      message_handler->ReportMessage(Message::kStdLibError, file_name);
+    }
+    return;
+  }
+  auto data_segment = DataSegment::Create(
+      DataRange(0, mapped_size_), static_cast<const Byte*>(mapped_address_),
+      DataSegment::BufferDispositionPolicy::kDontDelete);
+  data_source_.reset(new DataSegmentDataSource(data_segment));  // NOLINT
+}
+
+MmapDataSource::~MmapDataSource() {
+  data_source_.reset();
+  if (mapped_address_) {
+    munmap(mapped_address_, mapped_size_);
+  }
+}
+
+void MmapDataSource::Reset() {}
+
+std::shared_ptr<DataSegment> MmapDataSource::GetDataSegment(size_t begin,
+                                                            size_t min_size) {
+  return data_source_ ? data_source_->GetDataSegment(begin, min_size)
+                      : std::shared_ptr<DataSegment>(nullptr);
+}
+
+DataSource::TransferDataResult MmapDataSource::TransferData(
+    const DataRange& data_range, size_t best_size,
+    DataDestination* data_destination) {
+  if (data_source_) {
+    return data_source_->TransferData(data_range, best_size, data_destination);
+  }
+  return data_destination ? kTransferDataNone : kTransferDataError;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,109 @@
+#include "image_io/base/multi_pattern_matcher.h"
+
+#include <deque>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+constexpr uint32_t MultiPatternMatcher::kStartState;
+constexpr uint32_t MultiPatternMatcher::kNone;
+
+MultiPatternMatcher::MultiPatternMatcher()
+    : nodes_(1), root_transitions_(256, kStartState) {}
+
+size_t MultiPatternMatcher::AddPattern(const std::string& pattern) {
+  uint32_t node_index = kStartState;
+  for (char chr : pattern) {
+    Byte value = static_cast<Byte>(chr);
+    uint32_t child_index = GetChild(node_index, value);
+    if (child_index == kNone) {
+      child_index = static_cast<uint32_t>(nodes_.size());
+      nodes_[node_index].children.emplace_back(value, child_index);
+      nodes_.emplace_back();
+    }
+    node_index = child_index;
+  }
+  if (nodes_[node_index].pattern_index == kNone) {
+    nodes_[node_index].pattern_index = static_cast<uint32_t>(patterns_.size());
+    patterns_.push_back(pattern);
+    Compile();
+  }
+  return nodes_[node_index].pattern_index;
+}
+
+uint32_t MultiPatternMatcher::Scan(uint32_t state, const Byte* bytes,
+                                   size_t byte_count,
+                                   std::vector<bool>* matches) const {
+  if (matches->size() < patterns_.size()) {
+    matches->resize(patterns_.size(), false);
+  }
+  for (size_t index = 0; index < byte_count; ++index) {
+    Byte value = bytes[index];
+    uint32_t child_index = GetChild(state, value);
+    while (child_index == kNone && state != kStartState) {
+      state = nodes_[state].failure;
+      child_index = GetChild(state, value);
+    }
+    state = child_index == kNone ? kStartState : child_index;
+    for (uint32_t output = nodes_[state].pattern_index != kNone
+                               ? state
+                               : nodes_[state].output;
+         output != kNone; output = nodes_[output].output) {
+      (*matches)[nodes_[output].pattern_index] = true;
+    }
+  }
+  return state;
+}
+
+uint32_t MultiPatternMatcher::GetChild(uint32_t node_index, Byte value) const {
+  if (node_index == kStartState) {
+    uint32_t child_index = root_transitions_[value];
+    return child_index == kStartState ? kNone : child_index;
+  }
+  for (const auto& child : nodes_[node_index].children) {
+    if (child.first == value) {
+      return child.second;
+    }
+  }
+  return kNone;
+}
+
+void MultiPatternMatcher::Compile() {
+  // The root's transitions are looked up in a table, since every byte that
+  // does not continue a partial match goes through the root.
+  for (const auto& child : nodes_[kStartState].children) {
+    root_transitions_[child.first] = child.second;
+  }
+
+  // The failure link of a node depends on those of the nodes closer to the
+  // root, so the links are computed in breadth first order.
+  std::deque<uint32_t> queue;
+  for (const auto& child : nodes_[kStartState].children) {
+    nodes_[child.second].failure = kStartState;
+    nodes_[child.second].output = kNone;
+    queue.push_back(child.second);
+  }
+  while (!queue.empty()) {
+    uint32_t node_index = queue.front();
+    queue.pop_front();
+    for (const auto& child : nodes_[node_index].children) {
+      uint32_t failure = nodes_[node_index].failure;
+      uint32_t failure_child = GetChild(failure, child.first);
+      while (failure_child == kNone && failure != kStartState) {
+        failure = nodes_[failure].failure;
+        failure_child = GetChild(failure, child.first);
+      }
+      Node& child_node = nodes_[child.second];
+      child_node.failure =
+          failure_child == kNone ? kStartState : failure_child;
+      const Node& failure_node = nodes_[child_node.failure];
+      child_node.output = failure_node.pattern_index != kNone
+                              ? child_node.failure
+                              : failure_node.output;
+      queue.push_back(child.second);
+    }
+  }
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
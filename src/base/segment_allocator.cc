@@ -0,0 +1,98 @@
+#include "image_io/base/segment_allocator.h"
+
+#include <utility>
+#include <vector>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::shared_ptr;
+using std::unique_ptr;
+
+constexpr size_t BlockSegmentAllocator::kBlockSize;
+constexpr size_t BlockSegmentAllocator::kDefaultMaxFreeBlockCount;
+
+/// A thread safe free list of blocks. The blocks handed out by Acquire() are
+/// owned by shared pointers that give them back to the pool when the last
+/// segment allocated from them is released.
+class BlockSegmentAllocator::BlockPool {
+ public:
+  explicit BlockPool(size_t max_free_block_count)
+      : max_free_block_count_(max_free_block_count), new_block_count_(0) {}
+
+  /// @param pool The pool from which to acquire the block.
+  /// @return A free block from the pool, or a new one.
+  static shared_ptr<Byte> Acquire(const shared_ptr<BlockPool>& pool) {
+    Byte* bytes = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex_);
+      if (!pool->free_blocks_.empty()) {
+        bytes = pool->free_blocks_.back().release();
+        pool->free_blocks_.pop_back();
+      } else {
+        ++pool->new_block_count_;
+      }
+    }
+    if (!bytes) {
+      bytes = new Byte[kBlockSize];  // NOLINT
+    }
+    return shared_ptr<Byte>(bytes, [pool](Byte* block) {
+      pool->Release(block);
+    });
+  }
+
+  /// @return The number of blocks allocated from the heap so far.
+  size_t GetNewBlockCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return new_block_count_;
+  }
+
+ private:
+  /// @param block The block to put on the free list, or delete if the list is
+  ///     full.
+  void Release(Byte* block) {
+    unique_ptr<Byte[]> free_block(block);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_blocks_.size() < max_free_block_count_) {
+      free_blocks_.push_back(std::move(free_block));
+    }
+  }
+
+  std::mutex mutex_;
+  size_t max_free_block_count_;
+  size_t new_block_count_;
+  std::vector<unique_ptr<Byte[]>> free_blocks_;
+};
+
+BlockSegmentAllocator::BlockSegmentAllocator(size_t max_free_block_count)
+    : block_pool_(new BlockPool(max_free_block_count)),  // NOLINT
+      current_block_offset_(0) {}
+
+shared_ptr<DataSegment> BlockSegmentAllocator::Allocate(
+    const DataRange& data_range, Byte** buffer) {
+  size_t size = data_range.GetLength();
+  if (size > kBlockSize) {
+    return DataSegment::CreateWithBuffer(data_range, buffer);
+  }
+  shared_ptr<Byte> block;
+  size_t offset = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!current_block_ || kBlockSize - current_block_offset_ < size) {
+      current_block_ = BlockPool::Acquire(block_pool_);
+      current_block_offset_ = 0;
+    }
+    block = current_block_;
+    offset = current_block_offset_;
+    current_block_offset_ += size;
+  }
+  *buffer = block.get() + offset;
+  return DataSegment::Create(data_range, *buffer, std::move(block));
+}
+
+size_t BlockSegmentAllocator::GetNewBlockCount() const {
+  return block_pool_->GetNewBlockCount();
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,232 @@
+#include "image_io/base/xmp_property_tokenizer.h"
+
+#include <cstring>
+
+#include "image_io/base/data_context.h"
+#include "image_io/base/data_match_result.h"
+#include "image_io/base/data_scanner.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+namespace {
+
+/// @return Whether the value is an XML whitespace character.
+bool IsWhitespace(char value) {
+  return value == ' ' || value == '\t' || value == '\n' || value == '\r';
+}
+
+}  // namespace
+
+constexpr char XmpPropertyTokenizer::kLessThan[];
+constexpr char XmpPropertyTokenizer::kGreaterThan[];
+
+bool XmpProperty::HasQualifiedName(const char* qualified_name) const {
+  if (prefix.empty()) {
+    return name == qualified_name;
+  }
+  return strncmp(qualified_name, prefix.c_str(), prefix.length()) == 0 &&
+         qualified_name[prefix.length()] == ':' &&
+         name == qualified_name + prefix.length() + 1;
+}
+
+XmpPropertyTokenizer::XmpPropertyTokenizer(XmpPropertyProcessor* processor)
+    : processor_(processor),
+      state_(kText),
+      has_element_value_(false),
+      has_skipped_malformed_markup_(false) {
+  property_.is_attribute = false;
+}
+
+void XmpPropertyTokenizer::Reset() {
+  state_ = kText;
+  qualified_name_.clear();
+  element_name_.clear();
+  has_element_value_ = false;
+  has_skipped_malformed_markup_ = false;
+  property_.value_ranges.clear();
+  text_scanner_.Reset();
+  markup_end_scanner_.Reset();
+  name_scanner_.Reset();
+  whitespace_scanner_.Reset();
+  quoted_string_scanner_.Reset();
+}
+
+void XmpPropertyTokenizer::Tokenize(const DataSegment& data_segment,
+                                    const DataRange& range) {
+  size_t location = range.GetBegin();
+  while (location < range.GetEnd()) {
+    DataContext context(location, range, data_segment, data_line_map_);
+    const char* cbytes = context.GetCharBytes();
+    if (!cbytes) {
+      return;
+    }
+    char value = *cbytes;
+    size_t bytes_consumed = 0;
+    switch (state_) {
+      case kText: {
+        // The text up to the next tag is the value of the element whose start
+        // tag was the last tag, if the next tag is its end tag.
+        DataMatchResult result = text_scanner_.Scan(context);
+        bytes_consumed = result.GetBytesConsumed();
+        bool is_full = result.GetType() == DataMatchResult::kFull;
+        if (has_element_value_) {
+          AddValueRange(location,
+                        location + bytes_consumed - (is_full ? 1 : 0));
+        }
+        if (is_full) {
+          text_scanner_.Reset();
+          SetState(kTagStart);
+        }
+        break;
+      }
+      case kTagStart:
+        if (value == '/') {
+          bytes_consumed = 1;
+          SetState(kEndTag);
+        } else if (value == '?' || value == '!') {
+          has_element_value_ = false;
+          bytes_consumed = 1;
+          SetState(kMarkupEnd);
+        } else {
+          has_element_value_ = false;
+          qualified_name_.clear();
+          SetState(kTagName);
+        }
+        break;
+      case kMarkupEnd:
+      case kEndTag: {
+        DataMatchResult result = markup_end_scanner_.Scan(context);
+        bytes_consumed = result.GetBytesConsumed();
+        if (result.GetType() == DataMatchResult::kFull) {
+          markup_end_scanner_.Reset();
+          if (state_ == kEndTag && has_element_value_) {
+            ProcessProperty(element_name_, false);
+          }
+          has_element_value_ = false;
+          SetState(kText);
+        }
+        break;
+      }
+      case kTagName:
+      case kAttributeName: {
+        DataMatchResult result = name_scanner_.Scan(context);
+        bytes_consumed = result.GetBytesConsumed();
+        qualified_name_.append(cbytes, bytes_consumed);
+        if (result.GetType() == DataMatchResult::kError) {
+          name_scanner_.Reset();
+          SkipMalformedMarkup(kMarkupEnd);
+        } else if (result.GetType() == DataMatchResult::kFull) {
+          name_scanner_.Reset();
+          if (state_ == kTagName) {
+            element_name_ = qualified_name_;
+            SetState(kTagContent);
+          } else {
+            SetState(kEquals);
+          }
+        }
+        break;
+      }
+      case kTagContent:
+        if (IsWhitespace(value)) {
+          bytes_consumed = whitespace_scanner_.Scan(context).GetBytesConsumed();
+          whitespace_scanner_.Reset();
+        } else if (value == '>') {
+          bytes_consumed = 1;
+          has_element_value_ = true;
+          property_.value_ranges.clear();
+          SetState(kText);
+        } else if (DataScanner::IsFirstNameChar(value)) {
+          qualified_name_.clear();
+          SetState(kAttributeName);
+        } else if (value == '/') {
+          bytes_consumed = 1;
+          SetState(kEmptyTagEnd);
+        } else {
+          // An unexpected byte, such as a stray quote where an attribute was
+          // missing its equals sign, is skipped, rather than the rest of the
+          // tag, so that the attributes after it are still found.
+          bytes_consumed = 1;
+          SkipMalformedMarkup(kTagContent);
+        }
+        break;
+      case kEmptyTagEnd:
+        if (value == '>') {
+          bytes_consumed = 1;
+          has_element_value_ = false;
+          SetState(kText);
+        } else {
+          SkipMalformedMarkup(kTagContent);
+        }
+        break;
+      case kEquals:
+        if (IsWhitespace(value)) {
+          bytes_consumed = whitespace_scanner_.Scan(context).GetBytesConsumed();
+          whitespace_scanner_.Reset();
+        } else if (value == '=') {
+          bytes_consumed = 1;
+          SetState(kAttributeValue);
+        } else {
+          SkipMalformedMarkup(kTagContent);
+        }
+        break;
+      case kAttributeValue: {
+        bool is_started = quoted_string_scanner_.GetTokenRange().IsValid();
+        if (!is_started && IsWhitespace(value)) {
+          bytes_consumed = whitespace_scanner_.Scan(context).GetBytesConsumed();
+          whitespace_scanner_.Reset();
+          break;
+        }
+        if (!is_started && value != '"' && value != '\'') {
+          SkipMalformedMarkup(kTagContent);
+          break;
+        }
+        if (!is_started) {
+          property_.value_ranges.clear();
+        }
+        DataMatchResult result = quoted_string_scanner_.Scan(context);
+        bytes_consumed = result.GetBytesConsumed();
+        bool is_full = result.GetType() == DataMatchResult::kFull;
+        AddValueRange(location + (is_started ? 0 : 1),
+                      location + bytes_consumed - (is_full ? 1 : 0));
+        if (is_full) {
+          quoted_string_scanner_.Reset();
+          ProcessProperty(qualified_name_, true);
+          SetState(kTagContent);
+        }
+        break;
+      }
+    }
+    location += bytes_consumed;
+  }
+}
+
+void XmpPropertyTokenizer::AddValueRange(size_t begin, size_t end) {
+  if (begin >= end) {
+    return;
+  }
+  std::vector<DataRange>& value_ranges = property_.value_ranges;
+  if (!value_ranges.empty() && value_ranges.back().GetEnd() == begin) {
+    value_ranges.back() = DataRange(value_ranges.back().GetBegin(), end);
+  } else {
+    value_ranges.emplace_back(begin, end);
+  }
+}
+
+void XmpPropertyTokenizer::ProcessProperty(const std::string& qualified_name,
+                                           bool is_attribute) {
+  size_t colon = qualified_name.find(':');
+  if (colon == std::string::npos) {
+    property_.prefix.clear();
+    property_.name = qualified_name;
+  } else {
+    property_.prefix.assign(qualified_name, 0, colon);
+    property_.name.assign(qualified_name, colon + 1, std::string::npos);
+  }
+  property_.is_attribute = is_attribute;
+  processor_->Process(property_);
+  property_.value_ranges.clear();
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
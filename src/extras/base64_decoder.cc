@@ -0,0 +1,254 @@
+#include "image_io/extras/base64_decoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IMAGE_IO_BASE64_DECODER_X86 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGE_IO_BASE64_DECODER_NEON 1
+#endif
+
+#include <modp_b64/modp_b64.h>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+namespace {
+
+/// The signature of the functions that decode the leading part of a base64
+/// buffer with vector instructions.
+/// @param src The source bytes to decode.
+/// @param len The number of source bytes to decode.
+/// @param out The output buffer, at least len / 4 * 3 bytes long.
+/// @return The number of source bytes decoded, a multiple of 4. The number of
+///     bytes placed in the out buffer is this value / 4 * 3. The decoding stops
+///     before the first block that contains a character that is not one of the
+///     64 base64 characters - a pad char, an invalid char or end of the buffer.
+using VectorDecodeFunction = size_t (*)(const Byte* src, size_t len, Byte* out);
+
+// The vector decoders translate the characters to their 6 bit values using the
+// nibble lookup technique of Mula and Lemire's "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions". The low nibble of a character indexes the
+// kLowNibbleBits table, and the high nibble indexes the kHighNibbleBits table.
+// The two entries have a bit in common only for invalid characters. The high
+// nibble (adjusted for the '/' character) also indexes the kRollOffsets table
+// whose entry, when added to the character, yields its 6 bit value.
+// clang-format off
+alignas(16) constexpr Byte kLowNibbleBits[16] = {
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+    0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A};
+alignas(16) constexpr Byte kHighNibbleBits[16] = {
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+    0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10};
+alignas(16) constexpr Byte kRollOffsets[16] = {
+    0, 16, 19, 4, 0xBF, 0xBF, 0xB9, 0xB9, 0, 0, 0, 0, 0, 0, 0, 0};
+// clang-format on
+
+#if IMAGE_IO_BASE64_DECODER_X86
+
+/// Decodes 32 characters at a time using AVX2 instructions. The 24 decoded
+/// bytes of each block are written with a 32 byte store, so the loop stops
+/// while there is still enough room in the out buffer for the extra 8 bytes.
+__attribute__((target("avx2"))) size_t DecodeAvx2(const Byte* src, size_t len,
+                                                  Byte* out) {
+  const __m128i low_nibble_bits =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kLowNibbleBits));
+  const __m128i high_nibble_bits =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kHighNibbleBits));
+  const __m128i roll_offsets =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kRollOffsets));
+  const __m256i kLowNibbleLut = _mm256_broadcastsi128_si256(low_nibble_bits);
+  const __m256i kHighNibbleLut = _mm256_broadcastsi128_si256(high_nibble_bits);
+  const __m256i kRollLut = _mm256_broadcastsi128_si256(roll_offsets);
+  const __m256i k2F = _mm256_set1_epi8(0x2F);
+  const __m256i kMergeSextets = _mm256_set1_epi32(0x01400140);
+  const __m256i kMergeTwelveBits = _mm256_set1_epi32(0x00011000);
+  const __m256i kPackBytes = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i kPackLanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 0, 0);
+  size_t index = 0;
+  for (; index + 48 <= len; index += 32) {
+    __m256i chars =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + index));
+    __m256i high_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(chars, 4), k2F);
+    __m256i low_nibbles = _mm256_and_si256(chars, k2F);
+    __m256i low_bits = _mm256_shuffle_epi8(kLowNibbleLut, low_nibbles);
+    __m256i high_bits = _mm256_shuffle_epi8(kHighNibbleLut, high_nibbles);
+    if (!_mm256_testz_si256(low_bits, high_bits)) {
+      break;
+    }
+    __m256i roll_index =
+        _mm256_add_epi8(_mm256_cmpeq_epi8(chars, k2F), high_nibbles);
+    __m256i sextets = _mm256_add_epi8(
+        chars, _mm256_shuffle_epi8(kRollLut, roll_index));
+    __m256i words = _mm256_maddubs_epi16(sextets, kMergeSextets);
+    __m256i triplets = _mm256_madd_epi16(words, kMergeTwelveBits);
+    __m256i bytes = _mm256_permutevar8x32_epi32(
+        _mm256_shuffle_epi8(triplets, kPackBytes), kPackLanes);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + index / 4 * 3), bytes);
+  }
+  return index;
+}
+
+/// Decodes 16 characters at a time using SSE4.1 (and SSSE3) instructions. The
+/// 12 decoded bytes of each block are written with a 16 byte store, so the loop
+/// stops while there is still enough room in the out buffer for the extra 4.
+__attribute__((target("sse4.1"))) size_t DecodeSse41(const Byte* src,
+                                                     size_t len, Byte* out) {
+  const __m128i kLowNibbleLut =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kLowNibbleBits));
+  const __m128i kHighNibbleLut =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kHighNibbleBits));
+  const __m128i kRollLut =
+      _mm_load_si128(reinterpret_cast<const __m128i*>(kRollOffsets));
+  const __m128i k2F = _mm_set1_epi8(0x2F);
+  const __m128i kMergeSextets = _mm_set1_epi32(0x01400140);
+  const __m128i kMergeTwelveBits = _mm_set1_epi32(0x00011000);
+  const __m128i kPackBytes =
+      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t index = 0;
+  for (; index + 24 <= len; index += 16) {
+    __m128i chars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + index));
+    __m128i high_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), k2F);
+    __m128i low_nibbles = _mm_and_si128(chars, k2F);
+    __m128i low_bits = _mm_shuffle_epi8(kLowNibbleLut, low_nibbles);
+    __m128i high_bits = _mm_shuffle_epi8(kHighNibbleLut, high_nibbles);
+    if (!_mm_testz_si128(low_bits, high_bits)) {
+      break;
+    }
+    __m128i roll_index =
+        _mm_add_epi8(_mm_cmpeq_epi8(chars, k2F), high_nibbles);
+    __m128i sextets =
+        _mm_add_epi8(chars, _mm_shuffle_epi8(kRollLut, roll_index));
+    __m128i words = _mm_maddubs_epi16(sextets, kMergeSextets);
+    __m128i triplets = _mm_madd_epi16(words, kMergeTwelveBits);
+    __m128i bytes = _mm_shuffle_epi8(triplets, kPackBytes);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + index / 4 * 3), bytes);
+  }
+  return index;
+}
+
+#elif IMAGE_IO_BASE64_DECODER_NEON
+
+/// Translates 16 base64 characters to their 6 bit values.
+/// @param chars The characters to translate.
+/// @param invalid_bits Is or'd with a non-zero value for invalid characters.
+/// @return The 6 bit values of the characters.
+inline uint8x16_t TranslateNeon(uint8x16_t chars, uint8x16_t* invalid_bits) {
+  const uint8x16_t kLowNibbleLut = vld1q_u8(kLowNibbleBits);
+  const uint8x16_t kHighNibbleLut = vld1q_u8(kHighNibbleBits);
+  const uint8x16_t kRollLut = vld1q_u8(kRollOffsets);
+  uint8x16_t high_nibbles = vshrq_n_u8(chars, 4);
+  uint8x16_t low_nibbles = vandq_u8(chars, vdupq_n_u8(0x0F));
+  uint8x16_t low_bits = vqtbl1q_u8(kLowNibbleLut, low_nibbles);
+  uint8x16_t high_bits = vqtbl1q_u8(kHighNibbleLut, high_nibbles);
+  *invalid_bits = vorrq_u8(*invalid_bits, vandq_u8(low_bits, high_bits));
+  uint8x16_t roll_index =
+      vaddq_u8(vceqq_u8(chars, vdupq_n_u8(0x2F)), high_nibbles);
+  return vaddq_u8(chars, vqtbl1q_u8(kRollLut, roll_index));
+}
+
+/// Decodes 64 characters at a time using NEON instructions. The structured
+/// load and store instructions do the (de)interleaving, so the 48 decoded bytes
+/// of each block are written exactly.
+size_t DecodeNeon(const Byte* src, size_t len, Byte* out) {
+  size_t index = 0;
+  for (; index + 64 <= len; index += 64) {
+    uint8x16x4_t chars = vld4q_u8(src + index);
+    uint8x16_t invalid_bits = vdupq_n_u8(0);
+    uint8x16_t a = TranslateNeon(chars.val[0], &invalid_bits);
+    uint8x16_t b = TranslateNeon(chars.val[1], &invalid_bits);
+    uint8x16_t c = TranslateNeon(chars.val[2], &invalid_bits);
+    uint8x16_t d = TranslateNeon(chars.val[3], &invalid_bits);
+    if (vmaxvq_u8(invalid_bits) != 0) {
+      break;
+    }
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(out + index / 4 * 3, bytes);
+  }
+  return index;
+}
+
+#endif
+
+/// The vector decode function and its instruction set name for this processor.
+struct VectorDecoder {
+  VectorDecodeFunction function;
+  const char* name;
+};
+
+/// @return The best vector decoder for the processor this code is running on.
+VectorDecoder SelectVectorDecoder() {
+#if IMAGE_IO_BASE64_DECODER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return VectorDecoder{DecodeAvx2, "avx2"};
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return VectorDecoder{DecodeSse41, "sse4.1"};
+  }
+#elif IMAGE_IO_BASE64_DECODER_NEON
+  return VectorDecoder{DecodeNeon, "neon"};
+#endif
+  return VectorDecoder{nullptr, "none"};
+}
+
+/// @return The vector decoder, selected the first time this function is called.
+const VectorDecoder& GetVectorDecoder() {
+  static const VectorDecoder vector_decoder = SelectVectorDecoder();
+  return vector_decoder;
+}
+
+}  // namespace
+
+size_t Base64Decode(const Byte* src, size_t len, Byte* out, size_t* pad_count) {
+  // The base64 encoding is described at https://en.wikipedia.org/wiki/Base64.
+  // It uses these 64 printable characters: [0-9], [a-z], [A-Z], + and /. Since
+  // each character can represent 6 bits, 4 encoded characters can be used to
+  // represent 3 decoded bytes (6*4 = 3*8). There is the possibility that up to
+  // two padding bytes have to be added to the src that is encoded to ensure
+  // that the total number of encoded bytes is evenly divisible by 3. The = char
+  // is used for the purpose of completing the multiple-of-4 encoded bytes. The
+  // = may appear only at the end of the buffer being decoded, or else its an
+  // error.
+  const char kPadChar = '=';
+  if (len > 2 && src[len - 1] == kPadChar && src[len - 2] == kPadChar) {
+    // If the final two chars of the src buffer are pads then pad count is 2.
+    *pad_count = 2;
+  } else if (len > 1 && src[len - 1] == kPadChar) {
+    // If the final char of the src buffer is a pad then pad count is 1.
+    *pad_count = 1;
+  } else {
+    *pad_count = 0;
+  }
+
+  // The vector decoder never decodes a pad char, so the tail that holds them,
+  // and any invalid data, are always left for the modp_b64_decode function.
+  size_t vector_decoded_len = 0;
+  VectorDecodeFunction vector_decode = GetVectorDecoder().function;
+  if (vector_decode) {
+    vector_decoded_len = vector_decode(src, len, out);
+  }
+  size_t vector_bytes_decoded = vector_decoded_len / 4 * 3;
+  if (vector_decoded_len == len) {
+    return vector_bytes_decoded;
+  }
+  int bytes_decoded = modp_b64_decode(
+      reinterpret_cast<char*>(out + vector_bytes_decoded),
+      reinterpret_cast<const char*>(src + vector_decoded_len),
+      static_cast<int>(len - vector_decoded_len));
+  return bytes_decoded > 0 ? vector_bytes_decoded + bytes_decoded : 0;
+}
+
+const char* GetBase64DecodeInstructionSetName() {
+  return GetVectorDecoder().name;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -1,59 +1,17 @@
 #include "image_io/extras/base64_decoder_data_destination.h"
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
-#include <vector>
 
 #include "image_io/base/data_segment.h"
 #include "image_io/base/message_handler.h"
-#include <modp_b64/modp_b64.h>
+#include "image_io/extras/base64_decoder.h"
 
 namespace photos_editing_formats {
 namespace image_io {
 
 using std::shared_ptr;
-using std::unique_ptr;
-using std::vector;
-
-// Set this flag to 1 for debugging output.
-#define PHOTOS_EDITING_FORMATS_IMAGE_IO_EXTRAS_BASE64_DECODER_DATA_DEST_DEBUG 0
-
-/// A helper function to adjust the parameters for the base64 decoder function
-/// that are used by the Base64DecoderDataDestination to those that are required
-/// to call the modp_b64_decode function.
-/// @param src The source bytes to decode.
-/// @param len The number of source bytes to decode.
-/// @param out The output buffer to receive the decoded bytes, assumed to be
-///     large enough (which the Base64DecoderDataDestination code does).
-/// @param pad_count The number of pad characters detected at the end of the
-///     src buffer.
-/// @return The number of decoded bytes placed in the out buffer.
-static size_t base64_decode(const Byte* src, size_t len, Byte* out,
-                            size_t* pad_count) {
-  // The base64 encoding is described at https://en.wikipedia.org/wiki/Base64.
-  // It uses these 64 printable characters: [0-9], [a-z], [A-Z], + and /. Since
-  // each character can represent 6 bits, 4 encoded characters can be used to
-  // represent 3 decoded bytes (6*4 = 3*8). There is the possibility that up to
-  // two padding bytes have to be added to the src that is encoded to ensure
-  // that the total number of encoded bytes is evenly divisible by 3. The = char
-  // is used for the purpose of completing the multiple-of-4 encoded bytes. The
-  // = may appear only at the end of the buffer being decoded, or else its an
-  // error.
-  const char kPadChar = '=';
-  if (len > 2 && src[len - 1] == kPadChar && src[len - 2] == kPadChar) {
-    // If the final two chars of the src buffer are pads then pad count is 2.
-    *pad_count = 2;
-  } else if (len > 1 && src[len - 1] == kPadChar) {
-    // If the final char of the src buffer is a pad then pad count is 1.
-    *pad_count = 1;
-  } else {
-    *pad_count = 0;
-  }
-  int bytes_decoded = modp_b64_decode(reinterpret_cast<char*>(out),
-                                      reinterpret_cast<const char*>(src),
-                                      static_cast<int>(len));
-  return bytes_decoded > 0 ? bytes_decoded : 0;
-}
 
 void Base64DecoderDataDestination::StartTransfer() {
   next_destination_->StartTransfer();
@@ -70,19 +28,14 @@ DataDestination::TransferStatus Base64DecoderDataDestination::Transfer(
   // If there are left over bytes from the last call, steal enough bytes from
   // the current encoded buffer to make up chunk's worth. If there are no more
   // bytes in the encoded buffer (must be a small buffer) then we're done.
-#if PHOTOS_EDITING_FORMATS_IMAGE_IO_EXTRAS_BASE64_DECODER_DATA_DEST_DEBUG
-  std::stringstream sstream1;
-  sstream1 << "  " << leftover_bytes_.size() << " bytes left over";
-  MessageHandler::Get()->ReportMessage(MessageHandler::kStatus, sstream1.str());
-#endif  // PHOTOS_EDITING_FORMATS_IMAGE_IO_EXTRAS_BASE64_DECODER_DATA_DEST_DEBUG
+  ReportLeftoverBytesStatus(" bytes left over");
   size_t number_stolen_bytes = 0;
-  std::vector<Byte> leftover_and_stolen_bytes;
-  if (!leftover_bytes_.empty()) {
+  if (leftover_byte_count_) {
     // Note that because of the way the leftover_bytes are captured at the end
-    // of this function, leftover_bytes.size() will be in the range [0:4). The
+    // of this function, leftover_byte_count_ will be in the range [0:4). The
     // number_stolen_bytes is always less than or equal to the number of bytes
     // in the transfer_range. If the transfer_range happens to be small, and
-    // the leftover_bytes.size() + number_stolen_bytes does not equal 4, then
+    // the leftover_byte_count_ + number_stolen_bytes does not equal 4, then
     // no decoding can be done, and so the function just returns kTransferOk,
     // indicating that the transfer operation should continue. The next call to
     // Transfer() will either have enough bytes avaiable to be stolen so that
@@ -90,41 +43,45 @@ DataDestination::TransferStatus Base64DecoderDataDestination::Transfer(
     // repeated, up to 3 times, worst case, where the transfer_range length is
     // 1 each time Transfer is called.
     number_stolen_bytes =
-        std::min(transfer_range.GetLength(), 4 - leftover_bytes_.size() % 4);
-    leftover_bytes_.insert(leftover_bytes_.end(), encoded_buffer,
-                           encoded_buffer + number_stolen_bytes);
-    if (number_stolen_bytes == transfer_range.GetLength() &&
-        leftover_bytes_.size() % 4) {
+        std::min(transfer_range.GetLength(), 4 - leftover_byte_count_);
+    std::copy(encoded_buffer, encoded_buffer + number_stolen_bytes,
+              leftover_bytes_ + leftover_byte_count_);
+    leftover_byte_count_ += number_stolen_bytes;
+    if (leftover_byte_count_ < 4) {
       return kTransferOk;
     }
-    using std::swap;
-    swap(leftover_and_stolen_bytes, leftover_bytes_);
   }
 
   // Figure out the size of the buffer to hold the decoded bytes. When computing
   // the number_remaining_bytes, note that number_stolen_bytes is 0 if there are
-  // no leftover_bytes, or in the range [1:3], and if the transfer_range length
-  // equals the number_stolen_bytes, then the execution does not get to this
-  // point, but rather the function returns in the above code block. Thus it is
-  // safe to subtract number_stolen_bytes from the transfer_range's length to
-  // obtain a (guarenteed) positive value for number_remaining_bytes.
+  // no leftover_bytes, or in the range [1:3], and it never exceeds the length
+  // of the transfer_range, so number_remaining_bytes can't underflow.
   size_t number_remaining_bytes =
       transfer_range.GetLength() - number_stolen_bytes;
   size_t number_leftover_and_stolen_decoded_bytes =
-      leftover_and_stolen_bytes.size() / 4 * 3;
+      leftover_byte_count_ / 4 * 3;
   size_t number_remaining_chunks = number_remaining_bytes / 4;
   size_t number_remaining_decoded_bytes = number_remaining_chunks * 3;
   size_t decoded_buffer_length =
       number_leftover_and_stolen_decoded_bytes + number_remaining_decoded_bytes;
-  unique_ptr<Byte[]> decoded_buffer(new Byte[decoded_buffer_length]);
+  Byte* decoded_buffer = nullptr;
+  shared_ptr<DataSegment> decoded_data_segment;
+  if (segment_allocator_ && decoded_buffer_length) {
+    decoded_data_segment = segment_allocator_->Allocate(
+        DataRange(next_decoded_location_,
+                  next_decoded_location_ + decoded_buffer_length),
+        &decoded_buffer);
+  } else {
+    decoded_buffer = GetDecodedBuffer(decoded_buffer_length);
+  }
 
   // Decode the left over and stolen bytes first.
   size_t pad_count1 = 0;
   size_t total_bytes_decoded = 0;
   if (number_leftover_and_stolen_decoded_bytes) {
-    total_bytes_decoded = base64_decode(leftover_and_stolen_bytes.data(),
-                                        leftover_and_stolen_bytes.size(),
-                                        decoded_buffer.get(), &pad_count1);
+    total_bytes_decoded = Base64Decode(leftover_bytes_, leftover_byte_count_,
+                                       decoded_buffer, &pad_count1);
+    leftover_byte_count_ = 0;
     if (total_bytes_decoded + pad_count1 !=
         number_leftover_and_stolen_decoded_bytes) {
       if (message_handler_) {
@@ -138,9 +95,9 @@ DataDestination::TransferStatus Base64DecoderDataDestination::Transfer(
   // Decode the remaining bytes from the encoded buffer.
   size_t pad_count2 = 0;
   if (number_remaining_decoded_bytes) {
-    size_t number_bytes_decoded = base64_decode(
+    size_t number_bytes_decoded = Base64Decode(
         encoded_buffer + number_stolen_bytes, number_remaining_chunks * 4,
-        decoded_buffer.get() + total_bytes_decoded, &pad_count2);
+        decoded_buffer + total_bytes_decoded, &pad_count2);
     total_bytes_decoded += number_bytes_decoded;
     if (total_bytes_decoded + pad_count1 + pad_count2 !=
         decoded_buffer_length) {
@@ -159,28 +116,40 @@ DataDestination::TransferStatus Base64DecoderDataDestination::Transfer(
   size_t number_new_leftover_bytes =
       transfer_range.GetLength() - number_processed_bytes;
   if (number_new_leftover_bytes) {
-    leftover_bytes_.insert(
-        leftover_bytes_.end(), encoded_buffer + number_processed_bytes,
-        encoded_buffer + number_processed_bytes + number_new_leftover_bytes);
+    const Byte* new_leftover_bytes = encoded_buffer + number_processed_bytes;
+    std::copy(new_leftover_bytes,
+              new_leftover_bytes + number_new_leftover_bytes, leftover_bytes_);
+    leftover_byte_count_ = number_new_leftover_bytes;
   }
+  ReportLeftoverBytesStatus(" new bytes left over");
 
-#if PHOTOS_EDITING_FORMATS_IMAGE_IO_EXTRAS_BASE64_DECODER_DATA_DEST_DEBUG
-  std::stringstream sstream2;
-  sstream2 << "  " << leftover_bytes_.size() << " new bytes left over";
-  MessageHandler::Get()->ReportMessage(Message::kStatus, sstream2.str());
-#endif  // PHOTOS_EDITING_FORMATS_IMAGE_IO_EXTRAS_BASE64_DECODER_DATA_DEST_DEBUG
-
-  // And call the next stage
+  // And call the next stage. A segment from the allocator owns its buffer, and
+  // is trimmed to the decoded bytes with a view if there was padding. The
+  // decoded_buffer_ is reused by the next call to this function, and so is the
+  // decoded_data_segment_ that refers to it, which does not own it.
   size_t decoded_location = next_decoded_location_;
   next_decoded_location_ += (total_bytes_decoded);
   DataRange decoded_range(decoded_location, next_decoded_location_);
-  shared_ptr<DataSegment> decoded_data_segment =
-      DataSegment::Create(decoded_range, decoded_buffer.release());
-  return next_destination_->Transfer(decoded_range, *decoded_data_segment);
+  if (decoded_data_segment &&
+      decoded_data_segment->GetDataRange() != decoded_range) {
+    decoded_data_segment =
+        DataSegment::CreateView(decoded_data_segment, decoded_range);
+  }
+  if (decoded_data_segment) {
+    return next_destination_->Transfer(decoded_range, *decoded_data_segment);
+  }
+  if (!decoded_data_segment_) {
+    decoded_data_segment_ =
+        DataSegment::Create(decoded_range, decoded_buffer,
+                            DataSegment::BufferDispositionPolicy::kDontDelete);
+  } else {
+    decoded_data_segment_->SetBuffer(decoded_range, decoded_buffer);
+  }
+  return next_destination_->Transfer(decoded_range, *decoded_data_segment_);
 }
 
 void Base64DecoderDataDestination::FinishTransfer() {
-  if (leftover_bytes_.size() % 4) {
+  if (leftover_byte_count_) {
     if (message_handler_) {
       message_handler_->ReportMessage(Message::kDecodingError, "");
     }
@@ -189,5 +158,22 @@ void Base64DecoderDataDestination::FinishTransfer() {
   next_destination_->FinishTransfer();
 }
 
+void Base64DecoderDataDestination::ReportLeftoverBytesStatus(
+    const char* label) {
+  if (verbose_ && message_handler_) {
+    std::stringstream sstream;
+    sstream << "  " << leftover_byte_count_ << label;
+    message_handler_->ReportMessage(Message::kStatus, sstream.str());
+  }
+}
+
+Byte* Base64DecoderDataDestination::GetDecodedBuffer(size_t size) {
+  if (decoded_buffer_size_ < size) {
+    decoded_buffer_.reset(new Byte[size]);  // NOLINT
+    decoded_buffer_size_ = size;
+  }
+  return decoded_buffer_.get();
+}
+
 }  // namespace image_io
 }  // namespace photos_editing_formats
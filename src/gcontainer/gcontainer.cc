@@ -1,12 +1,16 @@
 #include "image_io/gcontainer/gcontainer.h"
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <fstream>
 
 #include "image_io/base/data_segment.h"
-#include "image_io/base/data_segment_data_source.h"
+#include "image_io/base/data_source.h"
+#include "image_io/base/fd_data_destination.h"
+#include "image_io/base/fd_data_source.h"
 #include "image_io/base/istream_data_source.h"
 #include "image_io/base/message_handler.h"
-#include "image_io/base/ostream_data_destination.h"
 #include "image_io/jpeg/jpeg_info.h"
 #include "image_io/jpeg/jpeg_info_builder.h"
 #include "image_io/jpeg/jpeg_scanner.h"
@@ -18,27 +22,58 @@ namespace gcontainer {
 namespace {
 
 using photos_editing_formats::image_io::DataRange;
-using photos_editing_formats::image_io::DataSegment;
-using photos_editing_formats::image_io::DataSegmentDataSource;
+using photos_editing_formats::image_io::DataSource;
+using photos_editing_formats::image_io::FdDataDestination;
+using photos_editing_formats::image_io::FdDataSource;
 using photos_editing_formats::image_io::IStreamRefDataSource;
 using photos_editing_formats::image_io::JpegInfoBuilder;
 using photos_editing_formats::image_io::JpegScanner;
 using photos_editing_formats::image_io::Message;
 using photos_editing_formats::image_io::MessageHandler;
-using photos_editing_formats::image_io::OStreamDataDestination;
 using std::string;
 
+// Closes a file descriptor when it goes out of scope.
+class ScopedFileDescriptor {
+ public:
+  explicit ScopedFileDescriptor(int fd) : fd_(fd) {}
+  ScopedFileDescriptor(const ScopedFileDescriptor&) = delete;
+  ScopedFileDescriptor& operator=(const ScopedFileDescriptor&) = delete;
+  ~ScopedFileDescriptor() { Close(); }
+
+  int Get() const { return fd_; }
+
+  // Returns true if the descriptor was closed without error.
+  bool Close() {
+    int fd = fd_;
+    fd_ = -1;
+    return fd < 0 || close(fd) == 0;
+  }
+
+ private:
+  int fd_;
+};
+
+// Opens a file with the given flags, reporting an error if it can't be opened.
+int OpenFile(const string& file_name, int flags,
+             MessageHandler* message_handler) {
+  int fd = open(file_name.c_str(), flags | O_CLOEXEC, 0666);
+  if (fd < 0 && message_handler) {
+    message_handler->ReportMessage(Message::kStdLibError, file_name);
+  }
+  return fd;
+}
+
 // Populates first_image_range with the first image (from the header metadata
-// to the EOI marker) present in the JPEG file input_file_name. Returns true if
-// such a first image is found, false otherwise.
+// to the EOI marker) present in the JPEG file held by data_source. Returns true
+// if such a first image is found, false otherwise.
 //
-// input_jpeg_stream must be a JPEG stream.
-// image_data_segment is populated with the DataSegment for
-// input_file_name, and is populated only in the successful case.
-// first_image_range is populated with the first image found in the input file,
+// data_source must hold a JPEG file, and is reset after the scan.
+// message_handler, if not null, is cleared and then receives the errors found
+// while scanning data_source.
+// first_image_range is populated with the first image found in data_source,
 // only if such an image is found.
 
-bool ExtractFirstImageInJpeg(std::istream& input_jpeg_stream,
+bool ExtractFirstImageInJpeg(DataSource* data_source,
                              MessageHandler* message_handler,
                              DataRange* first_image_range) {
   if (first_image_range == nullptr) {
@@ -51,12 +86,12 @@ bool ExtractFirstImageInJpeg(std::istream& input_jpeg_stream,
   }
 
   // Get the jpeg info and first image range from the input.
-  IStreamRefDataSource data_source(input_jpeg_stream);
   JpegInfoBuilder jpeg_info_builder;
   jpeg_info_builder.SetImageLimit(1);
   JpegScanner jpeg_scanner(message_handler);
-  jpeg_scanner.Run(&data_source, &jpeg_info_builder);
-  data_source.Reset();
+  jpeg_scanner.SetSparseScanning(true);
+  jpeg_scanner.Run(data_source, &jpeg_info_builder);
+  data_source->Reset();
 
   if (jpeg_scanner.HasError()) {
     return false;
@@ -82,26 +117,30 @@ bool WriteImageAndFiles(const string& input_file_name,
                         const std::vector<string>& other_files,
                         const string& output_file_name) {
   MessageHandler message_handler;
-  auto output_stream = OpenOutputFile(output_file_name, &message_handler);
-  if (!output_stream) {
+  ScopedFileDescriptor output_fd(OpenFile(
+      output_file_name, O_WRONLY | O_CREAT | O_TRUNC, &message_handler));
+  if (output_fd.Get() < 0) {
     return false;
   }
 
-  OStreamDataDestination output_destination(std::move(output_stream),
-                                            &message_handler);
+  // The bytes are copied between the files with FdDataSource and
+  // FdDataDestination, which do it in the kernel if the system supports it.
+  FdDataDestination output_destination(output_fd.Get(), &message_handler);
   output_destination.SetName(output_file_name);
 
   DataRange image_range;
-  std::unique_ptr<std::istream> input_stream =
-      OpenInputFile(input_file_name, &message_handler);
-
-  if (!ExtractFirstImageInJpeg(*input_stream, &message_handler, &image_range)) {
+  ScopedFileDescriptor input_fd(
+      OpenFile(input_file_name, O_RDONLY, &message_handler));
+  if (input_fd.Get() < 0) {
+    return false;
+  }
+  FdDataSource data_source(input_fd.Get(), &message_handler);
+  data_source.SetName(input_file_name);
+  if (!ExtractFirstImageInJpeg(&data_source, &message_handler, &image_range)) {
     return false;
   }
 
   output_destination.StartTransfer();
-  IStreamDataSource data_source(
-      OpenInputFile(input_file_name, &message_handler));
   data_source.TransferData(image_range, image_range.GetLength(),
                            &output_destination);
 
@@ -110,21 +149,30 @@ bool WriteImageAndFiles(const string& input_file_name,
     if (tack_on_file.empty()) {
       continue;
     }
-    auto tack_on_data_segment = ReadEntireFile(tack_on_file, &message_handler);
-    if (!tack_on_data_segment) {
+    size_t tack_on_size = 0;
+    ScopedFileDescriptor tack_on_fd(
+        OpenFile(tack_on_file, O_RDONLY, &message_handler));
+    if (tack_on_fd.Get() < 0 || !GetFileSize(tack_on_file, &tack_on_size) ||
+        tack_on_size == 0) {
       continue;
     }
 
-    DataSegmentDataSource tack_on_source(tack_on_data_segment);
-    DataRange tack_on_range = tack_on_data_segment->GetDataRange();
+    FdDataSource tack_on_source(tack_on_fd.Get(), &message_handler);
+    tack_on_source.SetName(tack_on_file);
+    DataRange tack_on_range(0, tack_on_size);
     bytes_transferred += tack_on_range.GetLength();
     tack_on_source.TransferData(tack_on_range, tack_on_range.GetLength(),
                                 &output_destination);
   }
 
   output_destination.FinishTransfer();
+  bool has_error = output_destination.HasError();
+  if (!output_fd.Close()) {
+    message_handler.ReportMessage(Message::kStdLibError, output_file_name);
+    has_error = true;
+  }
   return output_destination.GetBytesTransferred() == bytes_transferred &&
-         !output_destination.HasError();
+         !has_error;
 }
 
 bool ParseFileAfterImage(const std::string& input_file_name,
@@ -152,7 +200,8 @@ bool ParseFileAfterImageFromStream(size_t start_offset, size_t length,
 
   DataRange image_range;
   MessageHandler message_handler;
-  if (!ExtractFirstImageInJpeg(input_jpeg_stream, &message_handler,
+  IStreamRefDataSource data_source(input_jpeg_stream);
+  if (!ExtractFirstImageInJpeg(&data_source, &message_handler,
                                &image_range)) {
     return false;
   }
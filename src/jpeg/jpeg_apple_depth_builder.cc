@@ -53,6 +53,7 @@ bool GetJpegInfo(int image_limit, DataSource* data_source, JpegInfo* info,
   info_builder.SetImageLimit(image_limit);
   info_builder.SetCaptureSegmentBytes(kJfif);
   JpegScanner scanner(message_handler);
+  scanner.SetSparseScanning(true);
   scanner.Run(data_source, &info_builder);
   if (scanner.HasError()) {
     return false;
@@ -101,19 +102,22 @@ bool JpegAppleDepthBuilder::GetPrimaryImageData() {
     return false;
   }
   primary_image_range_ = info.GetImageRanges()[0];
-  JpegSegmentInfo jfif_segment_info = info.GetSegmentInfo(0, kJfif);
+  const JpegSegmentInfo& jfif_segment_info =
+      info.GetSegmentInfo(0, JpegInfo::kJfifTypeTag);
   if (!jfif_segment_info.IsValid() ||
-      jfif_segment_info.GetBytes().size() < kAmpfLength) {
+      jfif_segment_info.GetByteCount() < kAmpfLength) {
     return false;
   }
   primary_image_jfif_segment_range_ = jfif_segment_info.GetDataRange();
-  primary_image_jfif_segment_bytes_ = jfif_segment_info.GetBytes();
+  primary_image_jfif_segment_ = jfif_segment_info.GetDataSegment();
 
-  JpegSegmentInfo exif_info = info.GetSegmentInfo(0, kExif);
+  const JpegSegmentInfo& exif_info =
+      info.GetSegmentInfo(0, JpegInfo::kExifTypeTag);
   if (!exif_info.IsValid()) {
     return false;
   }
-  JpegSegmentInfo mpf_info = info.GetSegmentInfo(0, kMpf);
+  const JpegSegmentInfo& mpf_info =
+      info.GetSegmentInfo(0, JpegInfo::kMpfTypeTag);
   if (mpf_info.IsValid()) {
     primary_image_mpf_segment_range_ = mpf_info.GetDataRange();
   } else {
@@ -185,21 +189,34 @@ bool JpegAppleDepthBuilder::TransferPrimaryImage() {
 
 bool JpegAppleDepthBuilder::TransferNewJfifSegment(size_t* jfif_length_delta) {
   *jfif_length_delta = 0;
-  size_t jfif_size = primary_image_jfif_segment_bytes_.size();
-  Byte* jfif_bytes = new Byte[jfif_size + kAmpfLength];
-  memcpy(jfif_bytes, primary_image_jfif_segment_bytes_.data(), jfif_size);
-  if (memcmp(jfif_bytes + jfif_size - kAmpfLength, kAmpf, kAmpfLength) != 0) {
-    memcpy(jfif_bytes + jfif_size, kAmpf, kAmpfLength);
-    *jfif_length_delta = kAmpfLength;
-    jfif_size += kAmpfLength;
-    size_t jfif_data_length = jfif_size - 2;
-    jfif_bytes[2] = ((jfif_data_length >> 8) & 0xFF);
-    jfif_bytes[3] = (jfif_data_length & 0xFF);
+  DataRange jfif_range = primary_image_jfif_segment_->GetDataRange();
+  size_t jfif_begin = jfif_range.GetBegin();
+  size_t jfif_end = jfif_range.GetEnd();
+  size_t jfif_size = jfif_range.GetLength();
+  const Byte* jfif_bytes = primary_image_jfif_segment_->GetBuffer(jfif_begin);
+  DataSegmentDataSource jfif_data_source(primary_image_jfif_segment_);
+  if (memcmp(jfif_bytes + jfif_size - kAmpfLength, kAmpf, kAmpfLength) == 0) {
+    return TransferData(&jfif_data_source, jfif_range);
   }
-  DataRange jfif_range(0, jfif_size);
-  auto jfif_segment = DataSegment::Create(jfif_range, jfif_bytes);
-  DataSegmentDataSource jfif_data_source(jfif_segment);
-  return TransferData(&jfif_data_source, jfif_range);
+
+  // The captured segment bytes are transferred as they are, between a copy of
+  // the marker and length with the length adjusted and the AMPF suffix.
+  *jfif_length_delta = kAmpfLength;
+  size_t jfif_data_length = jfif_size + kAmpfLength - 2;
+  DataRange header_range(jfif_begin, jfif_begin + 4);
+  Byte* header_bytes = nullptr;
+  DataSegmentDataSource header_data_source(
+      DataSegment::CreateWithBuffer(header_range, &header_bytes));
+  memcpy(header_bytes, jfif_bytes, 2);
+  header_bytes[2] = ((jfif_data_length >> 8) & 0xFF);
+  header_bytes[3] = (jfif_data_length & 0xFF);
+  DataRange ampf_range(jfif_end, jfif_end + kAmpfLength);
+  DataSegmentDataSource ampf_data_source(DataSegment::Create(
+      ampf_range, reinterpret_cast<const Byte*>(kAmpf),
+      DataSegment::BufferDispositionPolicy::kDontDelete));
+  return TransferData(&header_data_source, header_range) &&
+         TransferData(&jfif_data_source, DataRange(jfif_begin + 4, jfif_end)) &&
+         TransferData(&ampf_data_source, ampf_range);
 }
 
 bool JpegAppleDepthBuilder::TransferNewMpfSegment(size_t jfif_length_delta) {
@@ -0,0 +1,83 @@
+#include "image_io/jpeg/jpeg_composite_segment_processor.h"
+
+#include "image_io/jpeg/jpeg_scanner.h"
+#include "image_io/jpeg/jpeg_segment.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+void JpegCompositeSegmentProcessor::AddProcessor(
+    JpegSegmentProcessor* processor) {
+  if (processor) {
+    processor_states_.emplace_back(processor);
+  }
+}
+
+void JpegCompositeSegmentProcessor::Start(JpegScanner* scanner) {
+  for (auto& state : processor_states_) {
+    state.interesting_marker_flags.reset();
+    state.done = false;
+    scanner->UpdateInterestingMarkerFlags(state.interesting_marker_flags);
+    state.processor->Start(scanner);
+    UpdateProcessorState(scanner, &state);
+  }
+  UpdateScanner(scanner);
+}
+
+void JpegCompositeSegmentProcessor::Process(JpegScanner* scanner,
+                                            const JpegSegment& segment) {
+  Byte type = segment.GetMarker().GetType();
+  bool state_changed = false;
+  for (auto& state : processor_states_) {
+    if (!state.done && state.interesting_marker_flags[type]) {
+      // Let the processor see and change its own flags rather than the union.
+      scanner->UpdateInterestingMarkerFlags(state.interesting_marker_flags);
+      state.processor->Process(scanner, segment);
+      state_changed |= UpdateProcessorState(scanner, &state);
+    }
+  }
+  if (state_changed) {
+    UpdateScanner(scanner);
+  } else {
+    scanner->UpdateInterestingMarkerFlags(interesting_marker_flags_);
+  }
+}
+
+void JpegCompositeSegmentProcessor::Finish(JpegScanner* scanner) {
+  for (auto& state : processor_states_) {
+    state.processor->Finish(scanner);
+  }
+}
+
+bool JpegCompositeSegmentProcessor::UpdateProcessorState(
+    JpegScanner* scanner, ProcessorState* state) {
+  bool state_changed = false;
+  if (scanner->GetInterestingMarkerFlags() != state->interesting_marker_flags) {
+    state->interesting_marker_flags = scanner->GetInterestingMarkerFlags();
+    state_changed = true;
+  }
+  if (scanner->IsDone()) {
+    state->done = true;
+    scanner->ClearDone();
+    state_changed = true;
+  }
+  return state_changed;
+}
+
+void JpegCompositeSegmentProcessor::UpdateScanner(JpegScanner* scanner) {
+  bool all_done = true;
+  interesting_marker_flags_.reset();
+  for (const auto& state : processor_states_) {
+    if (!state.done) {
+      interesting_marker_flags_ |= state.interesting_marker_flags;
+      all_done = false;
+    }
+  }
+  scanner->UpdateInterestingMarkerFlags(interesting_marker_flags_);
+  if (all_done) {
+    scanner->SetDone();
+  }
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
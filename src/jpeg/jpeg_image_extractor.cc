@@ -1,9 +1,14 @@
 #include "image_io/jpeg/jpeg_image_extractor.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <mutex>  // NOLINT
 #include <sstream>
 
 #include "image_io/base/data_range_tracking_destination.h"
 #include "image_io/base/message_handler.h"
+#include "image_io/extras/base64_decoder.h"
 #include "image_io/extras/base64_decoder_data_destination.h"
 #include "image_io/jpeg/jpeg_segment.h"
 #include "image_io/jpeg/jpeg_xmp_data_extractor.h"
@@ -21,6 +26,140 @@ namespace {
 /// The optimim size to use for the DataSource::TransferData() function.
 constexpr size_t kBestDataSize = 0x10000;
 
+/// The minimum number of encoded bytes decoded by each thread. Values smaller
+/// than this are not worth splitting up.
+constexpr size_t kMinParallelDecodeSize = 0x40000;
+
+/// A part of a base64 encoded value that was read from the data source.
+struct EncodedPiece {
+  /// The data segment that holds the bytes.
+  std::shared_ptr<DataSegment> data_segment;
+
+  /// The first byte of the piece in the data segment.
+  const Byte* bytes;
+
+  /// The offset of the piece in the encoded value.
+  size_t offset;
+
+  /// The number of bytes in the piece.
+  size_t length;
+};
+
+/// Decodes a part of the base64 encoded value made up of the pieces. Encoded
+/// quads that span two pieces are gathered before they are decoded, so the
+/// pieces can be of any size.
+/// @param pieces The pieces of the encoded value, in order.
+/// @param value_length The total length of the encoded value.
+/// @param begin The offset in the encoded value of the part, a multiple of 4.
+/// @param end The end of the part, a multiple of 4.
+/// @param decoded_bytes The buffer for the whole decoded value. The decoded
+///     bytes of the part are placed at begin / 4 * 3 in it.
+/// @param pad_count Receives the number of pad chars at the end of the part.
+///     Only the part that ends the value may have pad chars.
+/// @return True if the part was decoded successfully.
+bool DecodeEncodedPart(const vector<EncodedPiece>& pieces, size_t value_length,
+                       size_t begin, size_t end, Byte* decoded_bytes,
+                       size_t* pad_count) {
+  auto piece_iter = std::upper_bound(
+      pieces.begin(), pieces.end(), begin,
+      [](size_t offset, const EncodedPiece& piece) {
+        return offset < piece.offset;
+      });
+  --piece_iter;
+  *pad_count = 0;
+  for (size_t location = begin; location < end;) {
+    size_t piece_end = piece_iter->offset + piece_iter->length;
+    size_t available_length = std::min(end, piece_end) - location;
+    const Byte* encoded_bytes;
+    size_t encoded_length;
+    Byte quad[4];
+    if (available_length >= 4) {
+      encoded_bytes = piece_iter->bytes + (location - piece_iter->offset);
+      encoded_length = available_length / 4 * 4;
+    } else {
+      for (size_t index = 0; index < 4; ++index) {
+        while (location + index >= piece_iter->offset + piece_iter->length) {
+          ++piece_iter;
+        }
+        quad[index] =
+            piece_iter->bytes[location + index - piece_iter->offset];
+      }
+      encoded_bytes = quad;
+      encoded_length = 4;
+    }
+    size_t expected_length = encoded_length / 4 * 3;
+    size_t decoded_length =
+        Base64Decode(encoded_bytes, encoded_length,
+                     decoded_bytes + location / 4 * 3, pad_count);
+    location += encoded_length;
+    if (decoded_length + *pad_count != expected_length ||
+        (*pad_count && location != value_length)) {
+      return false;
+    }
+    if (location == piece_iter->offset + piece_iter->length &&
+        location < end) {
+      ++piece_iter;
+    }
+  }
+  return true;
+}
+
+/// The state of a parallel decode of a base64 encoded value, shared by the
+/// thread that started it and the tasks it submitted to the thread pool, some
+/// of which may only run after the decode is over.
+struct ParallelDecode {
+  /// The pieces of the encoded value, in order.
+  vector<EncodedPiece> pieces;
+
+  /// The total length of the encoded value.
+  size_t value_length;
+
+  /// The length of each part but the last, a multiple of 4.
+  size_t part_length;
+
+  /// The number of parts.
+  size_t part_count;
+
+  /// The buffer for the whole decoded value.
+  Byte* decoded_bytes;
+
+  /// Whether each part was decoded successfully.
+  vector<char> part_succeeded;
+
+  /// The number of pad chars at the end of each part.
+  vector<size_t> part_pad_counts;
+
+  /// The index of the next part to decode.
+  std::atomic<size_t> next_part;
+
+  /// The mutex that guards the finished_part_count.
+  std::mutex mutex;
+
+  /// Signaled when the last part has been decoded.
+  std::condition_variable parts_finished;
+
+  /// The number of parts that have been decoded.
+  size_t finished_part_count;
+};
+
+/// Decodes the parts of the value that no other thread has started, until
+/// there are none left.
+/// @param decode The state of the parallel decode.
+void DecodeParts(ParallelDecode* decode) {
+  for (size_t part = decode->next_part++; part < decode->part_count;
+       part = decode->next_part++) {
+    size_t begin = std::min(part * decode->part_length, decode->value_length);
+    size_t end = std::min(begin + decode->part_length, decode->value_length);
+    decode->part_succeeded[part] = DecodeEncodedPart(
+        decode->pieces, decode->value_length, begin, end,
+        decode->decoded_bytes, &decode->part_pad_counts[part]);
+    std::lock_guard<std::mutex> lock(decode->mutex);
+    if (++decode->finished_part_count == decode->part_count) {
+      decode->parts_finished.notify_all();
+    }
+  }
+}
+
 }  // namespace
 
 bool JpegImageExtractor::ExtractAppleDepthImage(
@@ -74,6 +213,11 @@ bool JpegImageExtractor::ExtractImage(JpegXmpInfo::Type xmp_info_type,
                                       DataDestination* image_destination) {
   bool has_errors = false;
   const bool has_image = jpeg_info_.HasImage(xmp_info_type);
+  const vector<DataRange>& value_ranges =
+      jpeg_info_.GetValueDataRanges(xmp_info_type);
+  if (has_image && !value_ranges.empty()) {
+    return ExtractXmpValue(value_ranges, image_destination);
+  }
   Base64DecoderDataDestination base64_decoder(image_destination,
                                               message_handler_);
   const vector<DataRange>& data_ranges =
@@ -110,5 +254,122 @@ bool JpegImageExtractor::ExtractImage(JpegXmpInfo::Type xmp_info_type,
   return has_image && !has_errors;
 }
 
+bool JpegImageExtractor::ExtractXmpValue(const vector<DataRange>& value_ranges,
+                                         DataDestination* image_destination) {
+  // If the value is decoded in parallel it is sent in one piece. Otherwise, or
+  // if that fails, decode it sequentially, which reports any errors.
+  std::unique_ptr<Byte[]> decoded_bytes;
+  size_t decoded_size = 0;
+  if (thread_pool_ &&
+      DecodeXmpValueInParallel(value_ranges, &decoded_bytes, &decoded_size)) {
+    DataRange decoded_range(0, decoded_size);
+    auto data_segment =
+        DataSegment::Create(decoded_range, decoded_bytes.release());
+    image_destination->StartTransfer();
+    DataDestination::TransferStatus status =
+        decoded_range.IsValid()
+            ? image_destination->Transfer(decoded_range, *data_segment)
+            : DataDestination::kTransferDone;
+    image_destination->FinishTransfer();
+    return status != DataDestination::kTransferError;
+  }
+
+  // The value ranges are in value order and hold nothing but the base64 data,
+  // so they can be sent directly to the decoder, no matter where the segments
+  // that contain them are in the data source.
+  bool has_errors = false;
+  Base64DecoderDataDestination base64_decoder(image_destination,
+                                              message_handler_);
+  base64_decoder.StartTransfer();
+  for (const auto& value_range : value_ranges) {
+    DataSource::TransferDataResult result = data_source_->TransferData(
+        value_range, kBestDataSize, &base64_decoder);
+    if (result == DataSource::kTransferDataError) {
+      has_errors = true;
+      break;
+    } else if (result == DataSource::kTransferDataNone) {
+      has_errors = true;
+      if (message_handler_) {
+        message_handler_->ReportMessage(Message::kPrematureEndOfDataError, "");
+      }
+    }
+  }
+  base64_decoder.FinishTransfer();
+  return !has_errors;
+}
+
+bool JpegImageExtractor::DecodeXmpValueInParallel(
+    const vector<DataRange>& value_ranges,
+    std::unique_ptr<Byte[]>* decoded_bytes, size_t* decoded_size) {
+  // Read the encoded value on this thread, since data sources need not be
+  // thread safe. The pieces share the ownership of the data segments.
+  auto decode = std::make_shared<ParallelDecode>();
+  vector<EncodedPiece>& pieces = decode->pieces;
+  size_t value_length = 0;
+  for (const auto& value_range : value_ranges) {
+    for (size_t location = value_range.GetBegin();
+         location < value_range.GetEnd();) {
+      std::shared_ptr<DataSegment> data_segment = data_source_->GetDataSegment(
+          location, value_range.GetEnd() - location);
+      if (!data_segment || !data_segment->Contains(location)) {
+        return false;
+      }
+      size_t end = std::min(data_segment->GetEnd(), value_range.GetEnd());
+      pieces.push_back(EncodedPiece{data_segment,
+                                    data_segment->GetBuffer(location),
+                                    value_length, end - location});
+      value_length += end - location;
+      location = end;
+    }
+  }
+  if (value_length == 0 || value_length % 4) {
+    return false;
+  }
+
+  // Split the value into quad aligned parts, one per pool worker plus one for
+  // this thread, and decode them directly into their place in the decoded
+  // buffer. This thread decodes parts too, and any that the workers have not
+  // started by the time it is done with its own, so it never waits for a
+  // part that is still queued.
+  size_t part_count =
+      std::min(thread_pool_->GetThreadCount() + 1,
+               std::max(value_length / kMinParallelDecodeSize, size_t(1)));
+  size_t quad_count = value_length / 4;
+  std::unique_ptr<Byte[]> decoded_buffer(
+      new Byte[quad_count * 3]);  // NOLINT
+  decode->value_length = value_length;
+  decode->part_length = (quad_count + part_count - 1) / part_count * 4;
+  decode->part_count = part_count;
+  decode->decoded_bytes = decoded_buffer.get();
+  decode->part_succeeded.assign(part_count, 0);
+  decode->part_pad_counts.assign(part_count, 0);
+  decode->next_part = 0;
+  decode->finished_part_count = 0;
+  for (size_t part = 1; part < part_count; ++part) {
+    thread_pool_->Submit(
+        [decode](size_t worker_index) { DecodeParts(decode.get()); });
+  }
+  DecodeParts(decode.get());
+  {
+    std::unique_lock<std::mutex> lock(decode->mutex);
+    decode->parts_finished.wait(lock, [&decode]() {
+      return decode->finished_part_count == decode->part_count;
+    });
+  }
+  const vector<char>& part_succeeded = decode->part_succeeded;
+  if (std::find(part_succeeded.begin(), part_succeeded.end(), 0) !=
+      part_succeeded.end()) {
+    return false;
+  }
+  // Only the part at the end of the value can have pad chars.
+  size_t pad_count = 0;
+  for (size_t part_pad_count : decode->part_pad_counts) {
+    pad_count += part_pad_count;
+  }
+  *decoded_bytes = std::move(decoded_buffer);
+  *decoded_size = quad_count * 3 - pad_count;
+  return true;
+}
+
 }  // namespace image_io
 }  // namespace photos_editing_formats
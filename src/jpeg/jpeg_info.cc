@@ -0,0 +1,64 @@
+#include "image_io/jpeg/jpeg_info.h"
+
+#include <cstring>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+constexpr JpegInfo::SegmentInfoTypeTag JpegInfo::kJfifTypeTag;
+constexpr JpegInfo::SegmentInfoTypeTag JpegInfo::kExifTypeTag;
+constexpr JpegInfo::SegmentInfoTypeTag JpegInfo::kMpfTypeTag;
+constexpr JpegInfo::SegmentInfoTypeTag JpegInfo::kNoTypeTag;
+
+JpegInfo::JpegInfo() {
+  JpegXmpInfo::InitializeVector(&xmp_info_vector_);
+  segment_info_type_tags_[kJfif] = kJfifTypeTag;
+  segment_info_type_tags_[kExif] = kExifTypeTag;
+  segment_info_type_tags_[kMpf] = kMpfTypeTag;
+}
+
+JpegInfo::SegmentInfoTypeTag JpegInfo::GetSegmentInfoTypeTag(
+    const std::string& type) const {
+  auto iter = segment_info_type_tags_.find(type);
+  return iter != segment_info_type_tags_.end() ? iter->second : kNoTypeTag;
+}
+
+const JpegSegmentInfo& JpegInfo::GetSegmentInfo(
+    size_t image_index, SegmentInfoTypeTag type_tag) const {
+  static const JpegSegmentInfo* invalid_segment_info =
+      new JpegSegmentInfo(0, DataRange(), "");  // NOLINT
+  if (type_tag == kNoTypeTag) {
+    return *invalid_segment_info;
+  }
+  auto iter = segment_info_index_.find(std::make_pair(image_index, type_tag));
+  return iter != segment_info_index_.end() ? segment_infos_[iter->second]
+                                           : *invalid_segment_info;
+}
+
+void JpegInfo::AddSegmentInfo(JpegSegmentInfo segment_info) {
+  auto type_tag = segment_info_type_tags_
+                      .emplace(segment_info.GetType(),
+                               segment_info_type_tags_.size())
+                      .first->second;
+  segment_info_index_.emplace(
+      std::make_pair(segment_info.GetImageIndex(), type_tag),
+      segment_infos_.size());
+  segment_infos_.push_back(std::move(segment_info));
+}
+
+void JpegInfo::CompactSegmentInfos() {
+  for (auto& segment_info : segment_infos_) {
+    const auto& data_segment = segment_info.GetDataSegment();
+    if (data_segment && data_segment->HasBufferOwner()) {
+      Byte* bytes = nullptr;
+      auto copy =
+          DataSegment::CreateWithBuffer(data_segment->GetDataRange(), &bytes);
+      memcpy(bytes, data_segment->GetBuffer(data_segment->GetBegin()),
+             data_segment->GetLength());
+      segment_info.SetDataSegment(std::move(copy));
+    }
+  }
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
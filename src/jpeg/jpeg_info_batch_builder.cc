@@ -0,0 +1,211 @@
+#include "image_io/jpeg/jpeg_info_batch_builder.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>  // NOLINT
+#include <sstream>
+
+#include "image_io/base/fd_data_source.h"
+#include "image_io/jpeg/jpeg_info_builder.h"
+#include "image_io/jpeg/jpeg_scanner.h"
+#include "image_io/utils/thread_pool.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+/// A DataSource that forwards the calls to another one, and counts the bytes
+/// in the distinct data segments that it returns.
+class CountingDataSource : public DataSource {
+ public:
+  explicit CountingDataSource(DataSource* data_source)
+      : data_source_(data_source), byte_count_(0) {}
+
+  /// @return The number of bytes in the data segments returned so far.
+  size_t GetByteCount() const { return byte_count_; }
+
+  void Reset() override { data_source_->Reset(); }
+
+  shared_ptr<DataSegment> GetDataSegment(size_t begin,
+                                         size_t min_size) override {
+    shared_ptr<DataSegment> data_segment =
+        data_source_->GetDataSegment(begin, min_size);
+    if (data_segment && data_segment != last_data_segment_.lock()) {
+      byte_count_ += data_segment->GetLength();
+      last_data_segment_ = data_segment;
+    }
+    return data_segment;
+  }
+
+  TransferDataResult TransferData(const DataRange& data_range, size_t best_size,
+                                  DataDestination* data_destination) override {
+    return data_source_->TransferData(data_range, best_size, data_destination);
+  }
+
+ private:
+  DataSource* data_source_;
+  size_t byte_count_;
+  std::weak_ptr<DataSegment> last_data_segment_;
+};
+
+}  // namespace
+
+/// The objects used by one worker thread, reused for each file it processes.
+class JpegInfoBatchBuilder::Worker {
+ public:
+  Worker()
+      : scanner_(&message_handler_),
+        fd_data_source_(-1, &message_handler_),
+        bytes_read_(0),
+        cached_file_count_(0) {
+    message_handler_.SetMessageWriter(nullptr);
+  }
+
+  MessageHandler* GetMessageHandler() { return &message_handler_; }
+  JpegScanner* GetScanner() { return &scanner_; }
+  FdDataSource* GetFdDataSource() { return &fd_data_source_; }
+  SegmentAllocator* GetSegmentAllocator() { return &segment_allocator_; }
+
+  /// @param byte_count The number of bytes read for a file.
+  void AddBytesRead(size_t byte_count) { bytes_read_ += byte_count; }
+  size_t GetBytesRead() const { return bytes_read_; }
+
+  /// Counts a file whose info was found in the cache.
+  void AddCachedFile() { ++cached_file_count_; }
+  size_t GetCachedFileCount() const { return cached_file_count_; }
+
+ private:
+  MessageHandler message_handler_;
+  JpegScanner scanner_;
+  FdDataSource fd_data_source_;
+  BlockSegmentAllocator segment_allocator_;
+  size_t bytes_read_;
+  size_t cached_file_count_;
+};
+
+vector<JpegInfoBatchResult> JpegInfoBatchBuilder::Run(
+    const vector<string>& file_names) {
+  return RunBatch(file_names.size(), [this, &file_names](
+                                         Worker* worker, size_t file_index,
+                                         JpegInfoBatchResult* result) {
+    const string& file_name = file_names[file_index];
+    if (cache_ && cache_->Lookup(file_name, &result->info)) {
+      worker->AddCachedFile();
+      return;
+    }
+    int fd = open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      worker->GetMessageHandler()->ReportMessage(Message::kStdLibError,
+                                                 file_name);
+      return;
+    }
+    FdDataSource* data_source = worker->GetFdDataSource();
+    data_source->SetFileDescriptor(fd);
+    data_source->SetName(file_name);
+    ScanDataSource(worker, data_source, result);
+    data_source->SetFileDescriptor(-1);
+    close(fd);
+    if (cache_ && !worker->GetMessageHandler()->HasErrorMessages()) {
+      cache_->Insert(file_name, result->info);
+    }
+  });
+}
+
+vector<JpegInfoBatchResult> JpegInfoBatchBuilder::Run(
+    const vector<DataSourceFactory>& data_source_factories) {
+  return RunBatch(data_source_factories.size(),
+                  [this, &data_source_factories](Worker* worker,
+                                                 size_t file_index,
+                                                 JpegInfoBatchResult* result) {
+                    MessageHandler* message_handler =
+                        worker->GetMessageHandler();
+                    unique_ptr<DataSource> data_source =
+                        data_source_factories[file_index](
+                            worker->GetSegmentAllocator(), message_handler);
+                    if (data_source) {
+                      ScanDataSource(worker, data_source.get(), result);
+                    } else if (!message_handler->HasErrorMessages()) {
+                      message_handler->ReportMessage(Message::kInternalError,
+                                                     "No data source");
+                    }
+                  });
+}
+
+void JpegInfoBatchBuilder::ScanDataSource(Worker* worker,
+                                          DataSource* data_source,
+                                          JpegInfoBatchResult* result) const {
+  JpegInfoBuilder info_builder;
+  info_builder.SetImageLimit(image_limit_);
+  for (const auto& segment_info_type : capture_segment_info_types_) {
+    info_builder.SetCaptureSegmentBytes(segment_info_type);
+  }
+  CountingDataSource counting_data_source(data_source);
+  JpegScanner* scanner = worker->GetScanner();
+  scanner->SetSparseScanning(sparse_scanning_);
+  scanner->Run(&counting_data_source, &info_builder);
+  result->info = info_builder.GetInfo();
+  worker->AddBytesRead(counting_data_source.GetByteCount());
+}
+
+vector<JpegInfoBatchResult> JpegInfoBatchBuilder::RunBatch(
+    size_t file_count,
+    const std::function<void(Worker* worker, size_t file_index,
+                             JpegInfoBatchResult* result)>& process_file) {
+  auto start_time = std::chrono::steady_clock::now();
+  vector<JpegInfoBatchResult> results(file_count);
+  vector<unique_ptr<Worker>> workers;
+  {
+    ThreadPool thread_pool(thread_count_);
+    for (size_t index = 0; index < thread_pool.GetThreadCount(); ++index) {
+      workers.emplace_back(new Worker);  // NOLINT
+    }
+    for (size_t file_index = 0; file_index < file_count; ++file_index) {
+      thread_pool.Submit([&workers, &results, &process_file,
+                          file_index](size_t worker_index) {
+        Worker* worker = workers[worker_index].get();
+        JpegInfoBatchResult* result = &results[file_index];
+        worker->GetMessageHandler()->ClearMessages();
+        process_file(worker, file_index, result);
+        result->messages = worker->GetMessageHandler()->GetMessages();
+      });
+    }
+    thread_pool.Wait();
+  }
+  std::chrono::duration<double> elapsed_time =
+      std::chrono::steady_clock::now() - start_time;
+
+  stats_ = JpegInfoBatchStats();
+  stats_.thread_count = workers.size();
+  stats_.file_count = file_count;
+  stats_.elapsed_seconds = elapsed_time.count();
+  for (const auto& worker : workers) {
+    stats_.bytes_read += worker->GetBytesRead();
+    stats_.cached_file_count += worker->GetCachedFileCount();
+  }
+  for (const auto& result : results) {
+    if (result.HasErrors()) {
+      ++stats_.error_file_count;
+    }
+  }
+  if (message_handler_) {
+    std::stringstream sstream;
+    sstream << stats_.file_count << " files (" << stats_.error_file_count
+            << " with errors, " << stats_.cached_file_count
+            << " from the cache), " << stats_.bytes_read << " bytes read in "
+            << stats_.elapsed_seconds << " s on " << stats_.thread_count
+            << " threads: " << stats_.GetFilesPerSecond() << " files/s, "
+            << stats_.GetBytesPerSecond() << " bytes/s";
+    message_handler_->ReportMessage(Message::kStatus, sstream.str());
+  }
+  return results;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -2,8 +2,10 @@
 
 #include <sstream>
 #include <string>
+#include <utility>
 
 #include "image_io/base/message_handler.h"
+#include "image_io/base/xmp_property_tokenizer.h"
 #include "image_io/jpeg/jpeg_marker.h"
 #include "image_io/jpeg/jpeg_scanner.h"
 #include "image_io/jpeg/jpeg_segment.h"
@@ -15,10 +17,162 @@ using std::string;
 using std::stringstream;
 using std::vector;
 
+/// The MPF tag of the MP entry array, and the size of each entry in it. See
+/// the CIPA DC-007 (Multi-Picture Format) specification, section 5.2.3.
+const uint32_t kMpfMpEntryTag = 0xB002;
+const size_t kMpfMpEntrySize = 16;
+
+/// The offsets in the TIFF style header and the IFD entries of the MPF segment.
+const size_t kMpfIfdOffsetOffset = 4;
+const size_t kMpfIfdEntryCountSize = 2;
+const size_t kMpfIfdEntrySize = 12;
+
+/// Reads an unsigned number from the segment using the MPF byte order. The
+/// locations of the numbers are computed from offsets read from the file, so
+/// they are 64 bit values that are checked against the segment's range here,
+/// rather than size_t values that could wrap around on 32 bit platforms.
+/// @param segment The segment to read from.
+/// @param location The location of the first byte of the number.
+/// @param byte_count The number of bytes in the number, at most four.
+/// @param big_endian Whether the number is stored with its high byte first.
+/// @param value A pointer to the variable to receive the number.
+/// @return Whether the segment contains all the bytes of the number.
+static bool GetMpfNumber(const JpegSegment& segment, uint64_t location,
+                         size_t byte_count, bool big_endian, uint32_t* value) {
+  *value = 0;
+  if (location < segment.GetBegin() ||
+      location + byte_count > segment.GetEnd()) {
+    return false;
+  }
+  for (size_t index = 0; index < byte_count; ++index) {
+    size_t offset = big_endian ? index : byte_count - 1 - index;
+    ValidatedByte validated_byte =
+        segment.GetValidatedByte(static_cast<size_t>(location) + offset);
+    if (!validated_byte.is_valid) {
+      return false;
+    }
+    *value = (*value << 8) | validated_byte.value;
+  }
+  return true;
+}
+
+namespace {
+
+/// The indices of the built in XMP namespace ids in the matcher, in the order
+/// they are added to it by the JpegInfoBuilder constructor.
+const size_t kXmpAppleDepthIdIndex = 0;
+const size_t kXmpAppleMatteIdIndex = 1;
+const size_t kXmpGDepthV1IdIndex = 2;
+const size_t kXmpGImageV1IdIndex = 3;
+
+/// An XmpPropertyProcessor that matches the namespace URIs declared in the XMP
+/// text against a set of ids, and collects the first value of each of the
+/// properties it is asked for.
+class XmpPropertyCollector : public XmpPropertyProcessor {
+ public:
+  /// @param segment The segment holding the XMP text.
+  /// @param id_matcher The matcher of the namespace ids.
+  /// @param property_names The qualified names of the properties to collect.
+  XmpPropertyCollector(const JpegSegment& segment,
+                       const MultiPatternMatcher& id_matcher,
+                       const vector<string>& property_names)
+      : segment_(segment),
+        id_matcher_(id_matcher),
+        property_names_(property_names),
+        property_values_(property_names.size()),
+        has_property_values_(property_names.size(), false) {}
+
+  void Process(const XmpProperty& property) override {
+    if (property.prefix == "xmlns" || property.HasQualifiedName("xmlns")) {
+      string namespace_uri = GetValue(property);
+      id_matcher_.Scan(MultiPatternMatcher::kStartState,
+                       reinterpret_cast<const Byte*>(namespace_uri.data()),
+                       namespace_uri.length(), &id_matches_);
+      return;
+    }
+    for (size_t index = 0; index < property_names_.size(); ++index) {
+      if (!has_property_values_[index] &&
+          property.HasQualifiedName(property_names_[index].c_str())) {
+        property_values_[index] = GetValue(property);
+        has_property_values_[index] = true;
+      }
+    }
+  }
+
+  /// @param id_index The index of an id in the matcher.
+  /// @return Whether any of the namespace URIs contains the id.
+  bool HasId(size_t id_index) const {
+    return id_index < id_matches_.size() && id_matches_[id_index];
+  }
+
+  /// Looks for the ids in all the bytes of the segment, and for the values of
+  /// the properties that were not found with a plain text search, for XMP text
+  /// so malformed that the tokenizer may have missed some of its namespaces
+  /// and properties.
+  void SearchSegmentBytes() {
+    size_t location = segment_.GetPayloadDataLocation();
+    uint32_t state = MultiPatternMatcher::kStartState;
+    while (location < segment_.GetEnd()) {
+      const Byte* bytes = nullptr;
+      size_t length =
+          segment_.GetContiguousBytes(location, segment_.GetEnd(), &bytes);
+      if (length == 0) {
+        break;
+      }
+      state = id_matcher_.Scan(state, bytes, length, &id_matches_);
+      location += length;
+    }
+    for (size_t index = 0; index < property_names_.size(); ++index) {
+      if (!has_property_values_[index]) {
+        property_values_[index] = segment_.ExtractXmpPropertyValue(
+            segment_.GetPayloadDataLocation(), property_names_[index].c_str());
+      }
+    }
+  }
+
+  /// @param index The index of the property in the property names.
+  /// @return The value of the property, or an empty string if not found.
+  const string& GetPropertyValue(size_t index) const {
+    return property_values_[index];
+  }
+
+ private:
+  /// @param property The property to get the value of.
+  /// @return The value of the property as a string.
+  string GetValue(const XmpProperty& property) const {
+    if (property.value_ranges.empty()) {
+      return "";
+    }
+    return segment_.ExtractString(
+        DataRange(property.value_ranges.front().GetBegin(),
+                  property.value_ranges.back().GetEnd()));
+  }
+
+  const JpegSegment& segment_;
+  const MultiPatternMatcher& id_matcher_;
+  vector<string> property_names_;
+  vector<string> property_values_;
+  vector<bool> has_property_values_;
+  vector<bool> id_matches_;
+};
+
+}  // namespace
+
 JpegInfoBuilder::JpegInfoBuilder()
     : image_limit_(std::numeric_limits<int>::max()), image_count_(0),
       gdepth_info_builder_(JpegXmpInfo::kGDepthInfoType),
-      gimage_info_builder_(JpegXmpInfo::kGImageInfoType) {}
+      gimage_info_builder_(JpegXmpInfo::kGImageInfoType) {
+  xmp_id_matcher_.AddPattern(kXmpAppleDepthId);
+  xmp_id_matcher_.AddPattern(kXmpAppleMatteId);
+  xmp_id_matcher_.AddPattern(kXmpGDepthV1Id);
+  xmp_id_matcher_.AddPattern(kXmpGImageV1Id);
+}
+
+void JpegInfoBuilder::AddXmpId(const std::string& xmp_id) {
+  if (!xmp_id.empty()) {
+    added_xmp_id_indices_.push_back(xmp_id_matcher_.AddPattern(xmp_id));
+  }
+}
 
 void JpegInfoBuilder::SetCaptureSegmentBytes(
     const std::string& segment_info_type) {
@@ -70,8 +224,8 @@ void JpegInfoBuilder::Process(JpegScanner* scanner,
     if (image_count_ > 0 && IsJfifSegment(segment)) {
       const auto& data_range = segment.GetDataRange();
       JpegSegmentInfo segment_info(image_count_ - 1, data_range, kJfif);
-      MaybeCaptureSegmentBytes(kJfif, segment, segment_info.GetMutableBytes());
-      jpeg_info_.AddSegmentInfo(segment_info);
+      MaybeCaptureSegmentBytes(kJfif, segment, &segment_info);
+      jpeg_info_.AddSegmentInfo(std::move(segment_info));
     }
   } else if (marker.GetType() == JpegMarker::kAPP2) {
     // APP2/MPF segments. JPEG files with Apple depth information have this
@@ -81,8 +235,11 @@ void JpegInfoBuilder::Process(JpegScanner* scanner,
       ++image_mpf_count_[image_count_ - 1];
       const auto& data_range = segment.GetDataRange();
       JpegSegmentInfo segment_info(image_count_ - 1, data_range, kMpf);
-      MaybeCaptureSegmentBytes(kMpf, segment, segment_info.GetMutableBytes());
-      jpeg_info_.AddSegmentInfo(segment_info);
+      MaybeCaptureSegmentBytes(kMpf, segment, &segment_info);
+      jpeg_info_.AddSegmentInfo(std::move(segment_info));
+      if (image_count_ == 1 && scanner->IsSparseScanning()) {
+        AddMpfImageRangeHints(scanner, segment);
+      }
     }
   } else if (marker.GetType() == JpegMarker::kAPP1) {
     // APP1/XMP segments. Both Apple depth and GDepthV1 image formats have
@@ -91,20 +248,7 @@ void JpegInfoBuilder::Process(JpegScanner* scanner,
     // one (that starts with kExtendedXmpId). Apple depth information is only in
     // the former, while GDepthV1/GImageV1 information is in both.
     if (IsPrimaryXmpSegment(segment)) {
-      // The primary XMP segment in a non-primary image (i.e., not the first
-      // image in the file) may contain Apple depth/matte information.
-      if (image_count_ > 1 && HasId(segment, kXmpAppleDepthId)) {
-        ++image_xmp_apple_depth_count_[image_count_ - 1];
-      } else if (image_count_ > 1 && HasId(segment, kXmpAppleMatteId)) {
-        ++image_xmp_apple_matte_count_[image_count_ - 1];
-      } else if (image_count_ == 1 && (HasId(segment, kXmpGDepthV1Id) ||
-                                       HasId(segment, kXmpGImageV1Id))) {
-        // The primary XMP segment in the primary image may contain GDepthV1
-        // and/or GImageV1 data.
-        SetPrimaryXmpGuid(segment);
-        SetXmpMimeType(segment, JpegXmpInfo::kGDepthInfoType);
-        SetXmpMimeType(segment, JpegXmpInfo::kGImageInfoType);
-      }
+      ProcessPrimaryXmpSegment(segment);
     } else if (image_count_ == 1 && IsExtendedXmpSegment(segment)) {
       // The extended XMP segment in the primary image may contain GDepth and/or
       // GImage data.
@@ -115,19 +259,25 @@ void JpegInfoBuilder::Process(JpegScanner* scanner,
     } else if (image_count_ > 0 && IsExifSegment(segment)) {
       const auto& data_range = segment.GetDataRange();
       JpegSegmentInfo segment_info(image_count_ - 1, data_range, kExif);
-      MaybeCaptureSegmentBytes(kExif, segment, segment_info.GetMutableBytes());
-      jpeg_info_.AddSegmentInfo(segment_info);
+      MaybeCaptureSegmentBytes(kExif, segment, &segment_info);
+      jpeg_info_.AddSegmentInfo(std::move(segment_info));
     }
   }
 }
 
 void JpegInfoBuilder::Finish(JpegScanner* scanner) {
+  gdepth_info_builder_.Finish();
+  gimage_info_builder_.Finish();
   jpeg_info_.SetSegmentDataRanges(
       JpegXmpInfo::kGDepthInfoType,
       gdepth_info_builder_.GetPropertySegmentRanges());
+  jpeg_info_.SetValueDataRanges(JpegXmpInfo::kGDepthInfoType,
+                                gdepth_info_builder_.GetPropertyValueRanges());
   jpeg_info_.SetSegmentDataRanges(
       JpegXmpInfo::kGImageInfoType,
       gimage_info_builder_.GetPropertySegmentRanges());
+  jpeg_info_.SetValueDataRanges(JpegXmpInfo::kGImageInfoType,
+                                gimage_info_builder_.GetPropertyValueRanges());
 }
 
 bool JpegInfoBuilder::HasAppleDepth() const {
@@ -179,23 +329,78 @@ bool JpegInfoBuilder::IsJfifSegment(const JpegSegment& segment) const {
   return segment.BytesAtLocationStartWith(payload_data_location, kJfif);
 }
 
-void JpegInfoBuilder::MaybeCaptureSegmentBytes(const std::string& type,
-                                               const JpegSegment& segment,
-                                               std::vector<Byte>* bytes) const {
+void JpegInfoBuilder::MaybeCaptureSegmentBytes(
+    const std::string& type, const JpegSegment& segment,
+    JpegSegmentInfo* segment_info) const {
   if (capture_segment_bytes_types_.count(type) == 0) {
     return;
   }
-  bytes->clear();
-  bytes->reserve(segment.GetLength());
-  size_t segment_begin = segment.GetBegin();
-  size_t segment_end = segment.GetEnd();
-  for (size_t location = segment_begin; location < segment_end; ++location) {
-    ValidatedByte validated_byte = segment.GetValidatedByte(location);
-    if (!validated_byte.is_valid) {
-      bytes->clear();
+  segment_info->SetDataSegment(
+      segment.ExtractDataSegment(segment.GetDataRange()));
+}
+
+void JpegInfoBuilder::AddMpfImageRangeHints(JpegScanner* scanner,
+                                            const JpegSegment& segment) const {
+  // The offsets in the MPF segment are relative to its TIFF style header, and
+  // the offset of the first image, which contains the segment, is zero.
+  size_t tiff_location = segment.GetPayloadDataLocation() + sizeof(kMpf);
+  bool big_endian = segment.BytesAtLocationStartWith(tiff_location, "MM");
+  if (!big_endian && !segment.BytesAtLocationStartWith(tiff_location, "II")) {
+    return;
+  }
+  // The offsets and sizes are untrusted 32 bit values, so the locations are
+  // computed as 64 bit values, which cannot wrap around.
+  uint32_t ifd_offset = 0;
+  uint32_t ifd_entry_count = 0;
+  if (!GetMpfNumber(segment, tiff_location + kMpfIfdOffsetOffset, 4,
+                    big_endian, &ifd_offset) ||
+      !GetMpfNumber(segment, uint64_t{tiff_location} + ifd_offset,
+                    kMpfIfdEntryCountSize, big_endian, &ifd_entry_count)) {
+    return;
+  }
+  uint64_t ifd_entry_location =
+      uint64_t{tiff_location} + ifd_offset + kMpfIfdEntryCountSize;
+  for (uint32_t ifd_entry = 0; ifd_entry < ifd_entry_count; ++ifd_entry) {
+    uint32_t tag = 0;
+    uint32_t mp_entry_byte_count = 0;
+    uint32_t mp_entry_offset = 0;
+    uint64_t location =
+        ifd_entry_location + uint64_t{ifd_entry} * kMpfIfdEntrySize;
+    if (!GetMpfNumber(segment, location, 2, big_endian, &tag)) {
       return;
     }
-    bytes->emplace_back(validated_byte.value);
+    if (tag != kMpfMpEntryTag) {
+      continue;
+    }
+    if (!GetMpfNumber(segment, location + 4, 4, big_endian,
+                      &mp_entry_byte_count) ||
+        !GetMpfNumber(segment, location + 8, 4, big_endian,
+                      &mp_entry_offset)) {
+      return;
+    }
+    uint64_t mp_entry_location = uint64_t{tiff_location} + mp_entry_offset;
+    for (size_t image = 0; image < mp_entry_byte_count / kMpfMpEntrySize;
+         ++image) {
+      uint32_t image_size = 0;
+      uint32_t image_offset = 0;
+      location = mp_entry_location + uint64_t{image} * kMpfMpEntrySize;
+      if (!GetMpfNumber(segment, location + 4, 4, big_endian, &image_size) ||
+          !GetMpfNumber(segment, location + 8, 4, big_endian,
+                        &image_offset)) {
+        return;
+      }
+      uint64_t image_begin = image_offset
+                                 ? uint64_t{tiff_location} + image_offset
+                                 : most_recent_soi_marker_range_.GetBegin();
+      uint64_t image_end = image_begin + image_size;
+      // Skip the hints for images that lie beyond the range of size_t.
+      if (static_cast<uint64_t>(static_cast<size_t>(image_end)) != image_end) {
+        continue;
+      }
+      scanner->AddImageRangeHint(DataRange(static_cast<size_t>(image_begin),
+                                           static_cast<size_t>(image_end)));
+    }
+    return;
   }
 }
 
@@ -211,21 +416,49 @@ bool JpegInfoBuilder::HasMatchingExtendedXmpGuid(
   return segment.BytesAtLocationStartWith(start, primary_xmp_guid_.c_str());
 }
 
-bool JpegInfoBuilder::HasId(const JpegSegment& segment, const char* id) const {
-  return segment.BytesAtLocationContain(segment.GetPayloadDataLocation(), id);
-}
+void JpegInfoBuilder::ProcessPrimaryXmpSegment(const JpegSegment& segment) {
+  if (image_count_ == 0) {
+    return;
+  }
+  vector<string> property_names{
+      kXmpHasExtendedId,
+      JpegXmpInfo::GetMimePropertyName(JpegXmpInfo::kGDepthInfoType),
+      JpegXmpInfo::GetMimePropertyName(JpegXmpInfo::kGImageInfoType)};
+  XmpPropertyCollector collector(segment, xmp_id_matcher_, property_names);
+  XmpPropertyTokenizer tokenizer(&collector);
+  size_t xmp_begin = segment.GetPayloadDataLocation() + sizeof(kXmpId);
+  segment.TokenizeXmpProperties(DataRange(xmp_begin, segment.GetEnd()),
+                                &tokenizer);
+  if (tokenizer.HasSkippedMalformedMarkup()) {
+    collector.SearchSegmentBytes();
+  }
 
-void JpegInfoBuilder::SetPrimaryXmpGuid(const JpegSegment& segment) {
-  primary_xmp_guid_ = segment.ExtractXmpPropertyValue(
-      segment.GetPayloadDataLocation(), kXmpHasExtendedId);
-}
+  for (size_t xmp_id_index : added_xmp_id_indices_) {
+    if (collector.HasId(xmp_id_index)) {
+      const string& type = xmp_id_matcher_.GetPattern(xmp_id_index);
+      JpegSegmentInfo segment_info(image_count_ - 1, segment.GetDataRange(),
+                                   type);
+      MaybeCaptureSegmentBytes(type, segment, &segment_info);
+      jpeg_info_.AddSegmentInfo(std::move(segment_info));
+    }
+  }
 
-void JpegInfoBuilder::SetXmpMimeType(const JpegSegment& segment,
-                                     JpegXmpInfo::Type xmp_info_type) {
-  string property_name = JpegXmpInfo::GetMimePropertyName(xmp_info_type);
-  jpeg_info_.SetMimeType(xmp_info_type, segment.ExtractXmpPropertyValue(
-                                            segment.GetPayloadDataLocation(),
-                                            property_name.c_str()));
+  // The primary XMP segment in a non-primary image (i.e., not the first image
+  // in the file) may contain Apple depth/matte information.
+  if (image_count_ > 1 && collector.HasId(kXmpAppleDepthIdIndex)) {
+    ++image_xmp_apple_depth_count_[image_count_ - 1];
+  } else if (image_count_ > 1 && collector.HasId(kXmpAppleMatteIdIndex)) {
+    ++image_xmp_apple_matte_count_[image_count_ - 1];
+  } else if (image_count_ == 1 && (collector.HasId(kXmpGDepthV1IdIndex) ||
+                                   collector.HasId(kXmpGImageV1IdIndex))) {
+    // The primary XMP segment in the primary image may contain GDepthV1
+    // and/or GImageV1 data.
+    primary_xmp_guid_ = collector.GetPropertyValue(0);
+    jpeg_info_.SetMimeType(JpegXmpInfo::kGDepthInfoType,
+                           collector.GetPropertyValue(1));
+    jpeg_info_.SetMimeType(JpegXmpInfo::kGImageInfoType,
+                           collector.GetPropertyValue(2));
+  }
 }
 
 }  // namespace image_io
@@ -0,0 +1,194 @@
+#include "image_io/jpeg/jpeg_info_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "image_io/jpeg/jpeg_info_serialization.h"
+#include "image_io/utils/file_utils.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+/// The tag and version number at the start of the index file.
+const char kIndexTag[] = "JICX";
+constexpr size_t kIndexTagLength = sizeof(kIndexTag) - 1;
+const UInt64 kIndexVersion = 2;
+
+/// @param index_file_name The name of an index file.
+/// @return The name of a temporary file to write the index file's contents to,
+///     in the same directory, that no other thread or process uses.
+string GetTemporaryIndexFileName(const string& index_file_name) {
+  static std::atomic<unsigned int> file_count(0);
+  return index_file_name + "." + std::to_string(getpid()) + "." +
+         std::to_string(file_count++) + ".tmp";
+}
+
+}  // namespace
+
+bool JpegInfoCache::GetFileIdentity(const string& file_name,
+                                    FileIdentity* identity) {
+  struct stat stat_buf;
+  if (stat(file_name.c_str(), &stat_buf)) {
+    return false;
+  }
+#if defined(__APPLE__)
+  const struct timespec& mtime = stat_buf.st_mtimespec;
+#else
+  const struct timespec& mtime = stat_buf.st_mtim;
+#endif
+  identity->device = static_cast<UInt64>(stat_buf.st_dev);
+  identity->inode = static_cast<UInt64>(stat_buf.st_ino);
+  identity->size = static_cast<UInt64>(stat_buf.st_size);
+  identity->modification_seconds = static_cast<UInt64>(mtime.tv_sec);
+  identity->modification_nanoseconds = static_cast<UInt64>(mtime.tv_nsec);
+  return true;
+}
+
+bool JpegInfoCache::Lookup(const string& file_name, JpegInfo* info) const {
+  FileIdentity identity;
+  if (!GetFileIdentity(file_name, &identity)) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = entries_.find(Key(identity.device, identity.inode));
+  if (iter == entries_.end() || iter->second.size != identity.size ||
+      iter->second.modification_seconds != identity.modification_seconds ||
+      iter->second.modification_nanoseconds !=
+          identity.modification_nanoseconds) {
+    return false;
+  }
+  if (info) {
+    *info = iter->second.info;
+  }
+  return true;
+}
+
+bool JpegInfoCache::Insert(const string& file_name, const JpegInfo& info) {
+  FileIdentity identity;
+  if (!GetFileIdentity(file_name, &identity)) {
+    if (message_handler_) {
+      message_handler_->ReportMessage(Message::kStdLibError, file_name);
+    }
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entries_[Key(identity.device, identity.inode)];
+  entry.size = identity.size;
+  entry.modification_seconds = identity.modification_seconds;
+  entry.modification_nanoseconds = identity.modification_nanoseconds;
+  entry.info = info;
+  entry.info.CompactSegmentInfos();
+  return true;
+}
+
+size_t JpegInfoCache::GetSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void JpegInfoCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+bool JpegInfoCache::Load(const string& index_file_name) {
+  size_t file_size = 0;
+  if (!GetFileSize(index_file_name, &file_size)) {
+    return false;
+  }
+  auto data_segment = ReadEntireFile(index_file_name, message_handler_);
+  if (!data_segment) {
+    return false;
+  }
+  const Byte* data = data_segment->GetBuffer(0);
+  size_t size = data_segment->GetLength();
+  size_t location = kIndexTagLength;
+  auto read_number = [data, size, &location](UInt64* value) {
+    size_t count =
+        DeserializeJpegInfoNumber(data + location, size - location, value);
+    location += count;
+    return count > 0;
+  };
+  UInt64 version = 0;
+  UInt64 entry_count = 0;
+  bool is_valid = size >= kIndexTagLength &&
+                  memcmp(data, kIndexTag, kIndexTagLength) == 0 &&
+                  read_number(&version) && version == kIndexVersion &&
+                  read_number(&entry_count);
+  vector<std::pair<Key, Entry>> new_entries;
+  for (UInt64 index = 0; is_valid && index < entry_count; ++index) {
+    Key key;
+    Entry entry;
+    is_valid = read_number(&key.first) && read_number(&key.second) &&
+               read_number(&entry.size) &&
+               read_number(&entry.modification_seconds) &&
+               read_number(&entry.modification_nanoseconds);
+    size_t count = is_valid ? DeserializeJpegInfo(data + location,
+                                                  size - location, &entry.info)
+                            : 0;
+    location += count;
+    is_valid = count > 0;
+    new_entries.emplace_back(key, entry);
+  }
+  if (!is_valid) {
+    if (message_handler_) {
+      message_handler_->ReportMessage(Message::kDecodingError,
+                                      index_file_name);
+    }
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& key_entry : new_entries) {
+    entries_[key_entry.first] = key_entry.second;
+  }
+  return true;
+}
+
+bool JpegInfoCache::Save(const string& index_file_name) const {
+  vector<Byte> bytes(kIndexTag, kIndexTag + kIndexTagLength);
+  SerializeJpegInfoNumber(kIndexVersion, &bytes);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SerializeJpegInfoNumber(entries_.size(), &bytes);
+    for (const auto& key_entry : entries_) {
+      SerializeJpegInfoNumber(key_entry.first.first, &bytes);
+      SerializeJpegInfoNumber(key_entry.first.second, &bytes);
+      SerializeJpegInfoNumber(key_entry.second.size, &bytes);
+      SerializeJpegInfoNumber(key_entry.second.modification_seconds, &bytes);
+      SerializeJpegInfoNumber(key_entry.second.modification_nanoseconds,
+                              &bytes);
+      SerializeJpegInfo(key_entry.second.info, &bytes);
+    }
+  }
+  string temporary_file_name = GetTemporaryIndexFileName(index_file_name);
+  auto ostream = OpenOutputFile(temporary_file_name, message_handler_);
+  if (!ostream) {
+    return false;
+  }
+  ostream->write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  ostream->flush();
+  bool written = ostream->good();
+  ostream.reset();
+  if (!written ||
+      std::rename(temporary_file_name.c_str(), index_file_name.c_str()) != 0) {
+    std::remove(temporary_file_name.c_str());
+    if (message_handler_) {
+      message_handler_->ReportMessage(Message::kStdLibError, index_file_name);
+    }
+    return false;
+  }
+  return true;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,258 @@
+#include "image_io/jpeg/jpeg_info_serialization.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+/// The tag and version number at the start of the binary form.
+const char kJpegInfoTag[] = "JINF";
+constexpr size_t kJpegInfoTagLength = sizeof(kJpegInfoTag) - 1;
+const UInt64 kJpegInfoVersion = 2;
+
+/// The Xmp info types in the order they appear in the binary form.
+const JpegXmpInfo::Type kXmpInfoTypes[] = {JpegXmpInfo::kGDepthInfoType,
+                                           JpegXmpInfo::kGImageInfoType};
+constexpr size_t kXmpInfoTypeCount =
+    sizeof(kXmpInfoTypes) / sizeof(kXmpInfoTypes[0]);
+
+void SerializeRange(const DataRange& data_range, vector<Byte>* bytes) {
+  SerializeJpegInfoNumber(data_range.GetBegin(), bytes);
+  SerializeJpegInfoNumber(data_range.GetEnd(), bytes);
+}
+
+void SerializeRanges(const vector<DataRange>& data_ranges,
+                     vector<Byte>* bytes) {
+  SerializeJpegInfoNumber(data_ranges.size(), bytes);
+  for (const auto& data_range : data_ranges) {
+    SerializeRange(data_range, bytes);
+  }
+}
+
+template <class T>
+void SerializeSequence(const T& sequence, vector<Byte>* bytes) {
+  SerializeJpegInfoNumber(sequence.size(), bytes);
+  bytes->insert(bytes->end(), sequence.begin(), sequence.end());
+}
+
+void SerializeDataSegment(const DataSegment* data_segment,
+                          vector<Byte>* bytes) {
+  size_t length = data_segment ? data_segment->GetLength() : 0;
+  SerializeJpegInfoNumber(length, bytes);
+  if (length > 0) {
+    const Byte* buffer = data_segment->GetBuffer(data_segment->GetBegin());
+    bytes->insert(bytes->end(), buffer, buffer + length);
+  }
+}
+
+/// A class to read the values of the binary form in sequence. Once a read
+/// fails all the following ones do too, so the values can be read without
+/// checking each one, and the validity checked at the end.
+class Reader {
+ public:
+  Reader(const Byte* data, size_t size)
+      : data_(data), size_(size), location_(0), is_valid_(true) {}
+
+  /// @return Whether all the reads so far were successful.
+  bool IsValid() const { return is_valid_; }
+
+  /// @return The number of bytes read so far.
+  size_t GetLocation() const { return location_; }
+
+  /// @return The next number, or 0 if it could not be read.
+  UInt64 ReadNumber() {
+    UInt64 value = 0;
+    size_t count = is_valid_ ? DeserializeJpegInfoNumber(
+                                   data_ + location_, size_ - location_, &value)
+                             : 0;
+    if (count == 0) {
+      is_valid_ = false;
+      return 0;
+    }
+    location_ += count;
+    return value;
+  }
+
+  /// @return The next number as a size_t, or 0 if it could not be read or is
+  ///     too large for a size_t.
+  size_t ReadSize() {
+    UInt64 value = ReadNumber();
+    if (static_cast<UInt64>(static_cast<size_t>(value)) != value) {
+      is_valid_ = false;
+      return 0;
+    }
+    return static_cast<size_t>(value);
+  }
+
+  /// Reads the count of the elements of a sequence. Each element uses at least
+  /// one byte, so a count larger than the number of bytes left is an error,
+  /// and a corrupted count can not cause a huge allocation.
+  /// @return The count, or 0 if it could not be read or is too large.
+  size_t ReadCount() {
+    UInt64 count = ReadNumber();
+    if (count > size_ - location_) {
+      is_valid_ = false;
+      return 0;
+    }
+    return static_cast<size_t>(count);
+  }
+
+  /// @return The next data range, or an empty one if it could not be read.
+  DataRange ReadRange() {
+    size_t begin = ReadSize();
+    size_t end = ReadSize();
+    return DataRange(begin, end);
+  }
+
+  /// @return The next vector of data ranges.
+  vector<DataRange> ReadRanges() {
+    vector<DataRange> data_ranges(ReadCount());
+    for (auto& data_range : data_ranges) {
+      data_range = ReadRange();
+    }
+    return data_ranges;
+  }
+
+  /// @param sequence The string or vector to receive the bytes.
+  template <class T>
+  void ReadSequence(T* sequence) {
+    size_t count = ReadCount();
+    const Byte* begin = data_ + location_;
+    sequence->assign(begin, begin + count);
+    location_ += count;
+  }
+
+  /// @param data_range The range of the segment whose bytes are read. The
+  ///     number of bytes must be the range's length.
+  /// @return The next data segment's bytes in a new data segment, or nullptr
+  ///     if there are none, or they could not be read.
+  std::shared_ptr<DataSegment> ReadDataSegment(const DataRange& data_range) {
+    size_t count = ReadCount();
+    if (count == 0) {
+      return nullptr;
+    }
+    if (count != data_range.GetLength()) {
+      is_valid_ = false;
+      return nullptr;
+    }
+    Byte* buffer = nullptr;
+    auto data_segment = DataSegment::CreateWithBuffer(data_range, &buffer);
+    if (!data_segment || !buffer) {
+      is_valid_ = false;
+      return nullptr;
+    }
+    memcpy(buffer, data_ + location_, count);
+    location_ += count;
+    return data_segment;
+  }
+
+  /// Reads the tag at the start of the binary form.
+  void ReadTag() {
+    if (!is_valid_ || size_ - location_ < kJpegInfoTagLength ||
+        memcmp(data_ + location_, kJpegInfoTag, kJpegInfoTagLength) != 0) {
+      is_valid_ = false;
+      return;
+    }
+    location_ += kJpegInfoTagLength;
+  }
+
+ private:
+  const Byte* data_;
+  size_t size_;
+  size_t location_;
+  bool is_valid_;
+};
+
+}  // namespace
+
+void SerializeJpegInfoNumber(UInt64 value, vector<Byte>* bytes) {
+  while (value >= 0x80) {
+    bytes->push_back(static_cast<Byte>(value | 0x80));
+    value >>= 7;
+  }
+  bytes->push_back(static_cast<Byte>(value));
+}
+
+size_t DeserializeJpegInfoNumber(const Byte* data, size_t size, UInt64* value) {
+  UInt64 result = 0;
+  for (size_t index = 0; index < size && index * 7 < 64; ++index) {
+    result |= static_cast<UInt64>(data[index] & 0x7F) << (index * 7);
+    if ((data[index] & 0x80) == 0) {
+      *value = result;
+      return index + 1;
+    }
+  }
+  return 0;
+}
+
+void SerializeJpegInfo(const JpegInfo& info, vector<Byte>* bytes) {
+  bytes->insert(bytes->end(), kJpegInfoTag, kJpegInfoTag + kJpegInfoTagLength);
+  SerializeJpegInfoNumber(kJpegInfoVersion, bytes);
+  SerializeRanges(info.GetImageRanges(), bytes);
+  SerializeJpegInfoNumber(info.GetSegmentInfos().size(), bytes);
+  for (const auto& segment_info : info.GetSegmentInfos()) {
+    SerializeJpegInfoNumber(segment_info.GetImageIndex(), bytes);
+    SerializeRange(segment_info.GetDataRange(), bytes);
+    SerializeSequence(segment_info.GetType(), bytes);
+    SerializeDataSegment(segment_info.GetDataSegment().get(), bytes);
+  }
+  SerializeRange(info.GetAppleDepthImageRange(), bytes);
+  SerializeRange(info.GetAppleMatteImageRange(), bytes);
+  SerializeJpegInfoNumber(kXmpInfoTypeCount, bytes);
+  for (JpegXmpInfo::Type type : kXmpInfoTypes) {
+    SerializeSequence(info.GetMimeType(type), bytes);
+    SerializeRanges(info.GetSegmentDataRanges(type), bytes);
+    SerializeRanges(info.GetValueDataRanges(type), bytes);
+  }
+}
+
+size_t DeserializeJpegInfo(const Byte* data, size_t size, JpegInfo* info) {
+  JpegInfo new_info;
+  Reader reader(data, size);
+  reader.ReadTag();
+  if (reader.ReadNumber() != kJpegInfoVersion) {
+    return 0;
+  }
+  for (const auto& image_range : reader.ReadRanges()) {
+    new_info.AddImageRange(image_range);
+  }
+  size_t segment_info_count = reader.ReadCount();
+  for (size_t index = 0; index < segment_info_count && reader.IsValid();
+       ++index) {
+    size_t image_index = reader.ReadSize();
+    DataRange data_range = reader.ReadRange();
+    string type;
+    reader.ReadSequence(&type);
+    JpegSegmentInfo segment_info(image_index, data_range, type);
+    segment_info.SetDataSegment(reader.ReadDataSegment(data_range));
+    new_info.AddSegmentInfo(std::move(segment_info));
+  }
+  new_info.SetAppleDepthImageRange(reader.ReadRange());
+  new_info.SetAppleMatteImageRange(reader.ReadRange());
+  if (reader.ReadCount() != kXmpInfoTypeCount) {
+    return 0;
+  }
+  for (JpegXmpInfo::Type type : kXmpInfoTypes) {
+    string mime_type;
+    reader.ReadSequence(&mime_type);
+    new_info.SetMimeType(type, mime_type);
+    new_info.SetSegmentDataRanges(type, reader.ReadRanges());
+    new_info.SetValueDataRanges(type, reader.ReadRanges());
+  }
+  if (!reader.IsValid()) {
+    return 0;
+  }
+  *info = new_info;
+  return reader.GetLocation();
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -1,6 +1,16 @@
 #include "image_io/jpeg/jpeg_scanner.h"
 
+#include <cstring>
 #include <sstream>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
 #include "image_io/base/message_handler.h"
 #include "image_io/jpeg/jpeg_segment.h"
@@ -15,10 +25,128 @@ using std::stringstream;
 /// DataSegments.
 const size_t kMinBufferDataRequestSize = 0x10000;
 
+/// The size of the DataSegments requested when the sparse scanning mode starts
+/// or jumps to a new location. The guarentee above still holds because a
+/// JpegSegment that starts in such a DataSegment ends in the next one, which
+/// is always requested with the larger kMinBufferDataRequestSize.
+const size_t kSparseBufferDataRequestSize = 0x1000;
+
+namespace {
+
+/// Finds the first 0xFF byte in the buffer that is not followed by a byte whose
+/// type is in the skippable set. Most of a JPEG file is entropy coded data in
+/// which 0xFF bytes only occur as the stuffed FF00 sequence or as RSTn markers,
+/// so the vector loops below reject whole blocks of that data at a time, and
+/// only fall back to the skippable flags for the rare 0xFF that survives.
+/// @param bytes The buffer to search.
+/// @param count The number of bytes in the buffer.
+/// @param skippable The marker types that do not end the search. The zero and
+///     fill types must be in this set.
+/// @return The index of the 0xFF byte, or count if there is none. If the last
+///     byte of the buffer is 0xFF its index is returned, since the marker type
+///     that follows it is not known.
+size_t FindMarkerStart(const Byte* bytes, size_t count,
+                       const JpegMarker::Flags& skippable) {
+  size_t index = 0;
+#if defined(__AVX2__)
+  const __m256i kFF = _mm256_set1_epi8(static_cast<char>(0xFF));
+  const __m256i k00 = _mm256_setzero_si256();
+  for (; index + 33 <= count; index += 32) {
+    __m256i current = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(bytes + index));
+    __m256i next = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(bytes + index + 1));
+    __m256i is_stuffed = _mm256_or_si256(_mm256_cmpeq_epi8(next, k00),
+                                         _mm256_cmpeq_epi8(next, kFF));
+    auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+        _mm256_andnot_si256(is_stuffed, _mm256_cmpeq_epi8(current, kFF))));
+    for (; mask != 0; mask &= mask - 1) {
+      size_t location = index + __builtin_ctz(mask);
+      if (!skippable[bytes[location + 1]]) {
+        return location;
+      }
+    }
+  }
+#elif defined(__SSE2__)
+  const __m128i kFF = _mm_set1_epi8(static_cast<char>(0xFF));
+  const __m128i k00 = _mm_setzero_si128();
+  for (; index + 17 <= count; index += 16) {
+    __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + index));
+    __m128i next =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + index + 1));
+    __m128i is_stuffed =
+        _mm_or_si128(_mm_cmpeq_epi8(next, k00), _mm_cmpeq_epi8(next, kFF));
+    auto mask = static_cast<unsigned int>(_mm_movemask_epi8(
+        _mm_andnot_si128(is_stuffed, _mm_cmpeq_epi8(current, kFF))));
+    for (; mask != 0; mask &= mask - 1) {
+      size_t location = index + __builtin_ctz(mask);
+      if (!skippable[bytes[location + 1]]) {
+        return location;
+      }
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t kFF = vdupq_n_u8(0xFF);
+  const uint8x16_t k00 = vdupq_n_u8(0x00);
+  for (; index + 17 <= count; index += 16) {
+    uint8x16_t current = vld1q_u8(bytes + index);
+    uint8x16_t next = vld1q_u8(bytes + index + 1);
+    uint8x16_t is_stuffed =
+        vorrq_u8(vceqq_u8(next, k00), vceqq_u8(next, kFF));
+    uint8x16_t is_candidate = vbicq_u8(vceqq_u8(current, kFF), is_stuffed);
+    if (vmaxvq_u8(is_candidate) == 0) {
+      continue;
+    }
+    for (size_t location = index; location < index + 16; ++location) {
+      if (bytes[location] == JpegMarker::kStart &&
+          !skippable[bytes[location + 1]]) {
+        return location;
+      }
+    }
+  }
+#endif
+  while (index < count) {
+    const void* found =
+        memchr(bytes + index, JpegMarker::kStart, count - index);
+    if (!found) {
+      return count;
+    }
+    size_t location = static_cast<const Byte*>(found) - bytes;
+    if (location + 1 == count || !skippable[bytes[location + 1]]) {
+      return location;
+    }
+    index = location + 1;
+  }
+  return count;
+}
+
+/// @return The flags of the marker types that do not have a variable length
+///     payload, i.e., the types of the segments that consist of a marker only.
+JpegMarker::Flags GetPayloadlessMarkerFlags() {
+  JpegMarker::Flags flags;
+  for (size_t type = 0; type < kJpegMarkerArraySize; ++type) {
+    flags[type] = !JpegMarker(static_cast<Byte>(type)).HasVariablePayloadSize();
+  }
+  return flags;
+}
+
+}  // namespace
+
+void JpegScanner::UpdateInterestingMarkerFlags(
+    const JpegMarker::Flags& marker_flags) {
+  static const JpegMarker::Flags payloadless_marker_flags =
+      GetPayloadlessMarkerFlags();
+  interesting_marker_flags_ = marker_flags;
+  skippable_marker_flags_ = payloadless_marker_flags & ~marker_flags;
+  skippable_marker_flags_[JpegMarker::kZERO] = true;
+  skippable_marker_flags_[JpegMarker::kFILL] = true;
+}
+
 void JpegScanner::Run(DataSource* data_source,
                       JpegSegmentProcessor* segment_processor) {
-  if (data_source_) {
-    // The Run() function is already active.
+  if (data_source_ || segment_processor_) {
+    // The Run() function or an incremental scan is already active.
     return;
   }
   data_source_ = data_source;
@@ -26,11 +154,14 @@ void JpegScanner::Run(DataSource* data_source,
   current_location_ = 0;
   done_ = false;
   has_error_ = false;
+  image_range_hints_.clear();
   data_source_->Reset();
   current_segment_ = data_source_->GetDataSegment(current_location_,
-                                                  kMinBufferDataRequestSize);
+                                                  GetJumpDataRequestSize());
   segment_processor_->Start(this);
-  FindAndProcessSegments();
+  if (current_segment_) {
+    FindAndProcessSegments();
+  }
   segment_processor_->Finish(this);
   data_source_ = nullptr;
   segment_processor_ = nullptr;
@@ -38,16 +169,175 @@ void JpegScanner::Run(DataSource* data_source,
   next_segment_.reset();
 }
 
+void JpegScanner::Start(JpegSegmentProcessor* segment_processor) {
+  if (data_source_ || segment_processor_) {
+    // The Run() function or an incremental scan is already active.
+    return;
+  }
+  segment_processor_ = segment_processor;
+  current_location_ = 0;
+  done_ = false;
+  has_error_ = false;
+  image_range_hints_.clear();
+  feed_state_ = kFeedFindMarker;
+  segment_bytes_.clear();
+  segment_processor_->Start(this);
+}
+
+void JpegScanner::Feed(const DataSegment& data_segment) {
+  if (data_source_ || !segment_processor_ || IsDone() || HasError()) {
+    return;
+  }
+  if (data_segment.GetBegin() > current_location_) {
+    if (feed_state_ != kFeedSkipPayload ||
+        data_segment.GetBegin() > segment_end_) {
+      ReportPrematureEndOfData(current_location_);
+      return;
+    }
+    current_location_ = data_segment.GetBegin();
+  }
+  while (!IsDone() && !HasError() &&
+         current_location_ < data_segment.GetEnd()) {
+    FeedBytes(data_segment);
+  }
+}
+
+void JpegScanner::Finish() {
+  if (data_source_ || !segment_processor_) {
+    return;
+  }
+  if (!IsDone() && !HasError() && feed_state_ != kFeedFindMarker &&
+      feed_state_ != kFeedSkipPayload) {
+    ReportPrematureEndOfData(current_location_);
+  }
+  SetDone();
+  segment_processor_->Finish(this);
+  segment_processor_ = nullptr;
+  feed_state_ = kFeedFindMarker;
+  segment_bytes_.clear();
+}
+
+void JpegScanner::FeedBytes(const DataSegment& data_segment) {
+  const Byte* buffer = data_segment.GetBuffer(current_location_);
+  size_t available_count = data_segment.GetEnd() - current_location_;
+  switch (feed_state_) {
+    case kFeedFindMarker: {
+      size_t begin =
+          current_location_ +
+          FindMarkerStart(buffer, available_count, skippable_marker_flags_);
+      if (begin < data_segment.GetEnd()) {
+        segment_begin_ = begin;
+        feed_state_ = kFeedMarkerType;
+        begin += 1;
+      }
+      current_location_ = begin;
+      break;
+    }
+    case kFeedMarkerType: {
+      JpegMarker marker(*buffer);
+      ++current_location_;
+      if (marker.GetType() == JpegMarker::kFILL) {
+        // The 0xFF that follows a fill byte may itself start the marker.
+        segment_begin_ = current_location_ - 1;
+      } else if (skippable_marker_flags_[marker.GetType()]) {
+        feed_state_ = kFeedFindMarker;
+      } else {
+        segment_bytes_.assign({JpegMarker::kStart, marker.GetType()});
+        segment_end_ = segment_begin_ + JpegMarker::kLength;
+        if (marker.HasVariablePayloadSize()) {
+          feed_state_ = kFeedPayloadSize;
+        } else {
+          feed_state_ = kFeedFindMarker;
+          ProcessCollectedSegment();
+        }
+      }
+      break;
+    }
+    case kFeedPayloadSize: {
+      segment_bytes_.push_back(*buffer);
+      ++current_location_;
+      if (segment_bytes_.size() < JpegMarker::kLength + 2) {
+        break;
+      }
+      size_t payload_size = (segment_bytes_[JpegMarker::kLength] << 8) |
+                            segment_bytes_[JpegMarker::kLength + 1];
+      segment_end_ = segment_begin_ + JpegMarker::kLength + payload_size;
+      if (!interesting_marker_flags_[segment_bytes_[JpegMarker::kTypeOffset]]) {
+        feed_state_ = kFeedSkipPayload;
+      } else if (segment_end_ <= current_location_) {
+        segment_bytes_.resize(segment_end_ - segment_begin_);
+        feed_state_ = kFeedFindMarker;
+        ProcessCollectedSegment();
+      } else if (data_segment.GetBegin() <= segment_begin_ &&
+                 segment_end_ <= data_segment.GetEnd()) {
+        // The whole segment is in the fed data, so there is no need to copy.
+        current_location_ = segment_end_;
+        feed_state_ = kFeedFindMarker;
+        JpegSegment segment(segment_begin_, segment_end_, &data_segment,
+                            nullptr);
+        segment_processor_->Process(this, segment);
+      } else {
+        segment_bytes_.reserve(segment_end_ - segment_begin_);
+        feed_state_ = kFeedSegment;
+      }
+      break;
+    }
+    case kFeedSegment: {
+      size_t count =
+          std::min(available_count, segment_end_ - current_location_);
+      segment_bytes_.insert(segment_bytes_.end(), buffer, buffer + count);
+      current_location_ += count;
+      if (current_location_ == segment_end_) {
+        feed_state_ = kFeedFindMarker;
+        ProcessCollectedSegment();
+      }
+      break;
+    }
+    case kFeedSkipPayload: {
+      current_location_ = std::min(data_segment.GetEnd(), segment_end_);
+      if (current_location_ == segment_end_) {
+        feed_state_ = kFeedFindMarker;
+      }
+      break;
+    }
+  }
+}
+
+void JpegScanner::ProcessCollectedSegment() {
+  auto data_segment = DataSegment::Create(
+      DataRange(segment_begin_, segment_begin_ + segment_bytes_.size()),
+      segment_bytes_.data(), DataSegment::BufferDispositionPolicy::kDontDelete);
+  JpegSegment segment(segment_begin_, segment_end_, data_segment.get(),
+                      nullptr);
+  segment_processor_->Process(this, segment);
+}
+
+void JpegScanner::ReportPrematureEndOfData(size_t location) {
+  if (message_handler_) {
+    stringstream sstream;
+    sstream << location;
+    message_handler_->ReportMessage(Message::kPrematureEndOfDataError,
+                                    sstream.str());
+  }
+  has_error_ = true;
+}
+
 void JpegScanner::FindAndProcessSegments() {
   while (!IsDone() && !HasError()) {
-    size_t begin_segment_location =
-        current_segment_->Find(current_location_, JpegMarker::kStart);
+    size_t begin_segment_location = FindMarkerCandidate();
     if (begin_segment_location == current_segment_->GetEnd()) {
-      GetNextSegment();
+      if (sparse_scanning_ && !next_segment_ &&
+          current_location_ > current_segment_->GetEnd()) {
+        // Jump over the uninteresting bytes that were skipped.
+        next_segment_ = data_source_->GetDataSegment(current_location_,
+                                                     GetJumpDataRequestSize());
+      } else {
+        GetNextSegment();
+      }
       if (next_segment_) {
         current_location_ =
             std::max(current_location_, next_segment_->GetBegin());
-        current_segment_ = next_segment_;
+        current_segment_ = std::move(next_segment_);
         next_segment_.reset();
         continue;
       }
@@ -57,6 +347,11 @@ void JpegScanner::FindAndProcessSegments() {
     size_t payload_size = 0;
     JpegMarker marker(
         GetByte(begin_segment_location + JpegMarker::kTypeOffset));
+    if (marker.GetType() == JpegMarker::kFILL && !HasError()) {
+      // The 0xFF that follows a fill byte may itself start the marker.
+      current_location_ = begin_segment_location + 1;
+      continue;
+    }
     if (marker.IsValid() && !HasError()) {
       payload_size = GetPayloadSize(marker, begin_segment_location);
       if (marker.IsValid() && interesting_marker_flags_[marker.GetType()]) {
@@ -72,7 +367,21 @@ void JpegScanner::FindAndProcessSegments() {
     }
     current_location_ =
         begin_segment_location + JpegMarker::kLength + payload_size;
+    if (sparse_scanning_ && marker.GetType() == JpegMarker::kSOS &&
+        !HasError()) {
+      MaybeSkipEntropyData();
+    }
+  }
+}
+
+size_t JpegScanner::FindMarkerCandidate() const {
+  const Byte* buffer = current_segment_->GetBuffer(current_location_);
+  if (!buffer) {
+    return current_segment_->GetEnd();
   }
+  size_t count = current_segment_->GetEnd() - current_location_;
+  return current_location_ +
+         FindMarkerStart(buffer, count, skippable_marker_flags_);
 }
 
 size_t JpegScanner::GetPayloadSize(const JpegMarker& marker,
@@ -118,5 +427,49 @@ void JpegScanner::GetNextSegment() {
   }
 }
 
+size_t JpegScanner::GetJumpDataRequestSize() const {
+  return sparse_scanning_ ? kSparseBufferDataRequestSize
+                          : kMinBufferDataRequestSize;
+}
+
+void JpegScanner::MaybeSkipEntropyData() {
+  for (const auto& image_range : image_range_hints_) {
+    if (!image_range.Contains(current_location_) ||
+        image_range.GetLength() < JpegMarker::kLength) {
+      continue;
+    }
+    size_t eoi_location = image_range.GetEnd() - JpegMarker::kLength;
+    if (eoi_location <= current_location_) {
+      return;
+    }
+    std::shared_ptr<DataSegment> eoi_segment;
+    if (!current_segment_->Contains(eoi_location) &&
+        !(next_segment_ && next_segment_->Contains(eoi_location))) {
+      eoi_segment = data_source_->GetDataSegment(eoi_location,
+                                                 GetJumpDataRequestSize());
+      if (!eoi_segment) {
+        return;
+      }
+    }
+    const DataSegment* segment1 =
+        eoi_segment ? eoi_segment.get() : current_segment_.get();
+    const DataSegment* segment2 =
+        eoi_segment ? nullptr : next_segment_.get();
+    ValidatedByte start =
+        DataSegment::GetValidatedByte(eoi_location, segment1, segment2);
+    ValidatedByte type = DataSegment::GetValidatedByte(
+        eoi_location + JpegMarker::kTypeOffset, segment1, segment2);
+    if (start.is_valid && start.value == JpegMarker::kStart && type.is_valid &&
+        type.value == JpegMarker::kEOI) {
+      if (eoi_segment) {
+        current_segment_ = std::move(eoi_segment);
+        next_segment_.reset();
+      }
+      current_location_ = eoi_location;
+    }
+    return;
+  }
+}
+
 }  // namespace image_io
 }  // namespace photos_editing_formats
@@ -1,15 +1,14 @@
 #include "image_io/jpeg/jpeg_segment.h"
 
+#include <algorithm>
 #include <cctype>
-#include <iomanip>
-#include <sstream>
+#include <cstring>
 #include <string>
 
 namespace photos_editing_formats {
 namespace image_io {
 
 using std::string;
-using std::stringstream;
 
 /// Finds the character allowing it to be preceded by whitespace characters.
 /// @param segment The segment in which to look for the character.
@@ -19,18 +18,23 @@ using std::stringstream;
 ///     of non whitespace characters are found first.
 static size_t SkipWhiteSpaceFindChar(const JpegSegment& segment,
                                      size_t start_location, char value) {
-  for (size_t location = start_location; location < segment.GetEnd();
-       ++location) {
-    ValidatedByte validated_byte = segment.GetValidatedByte(location);
-    if (!validated_byte.is_valid) {
+  size_t location = start_location;
+  while (location < segment.GetEnd()) {
+    const Byte* bytes = nullptr;
+    size_t length =
+        segment.GetContiguousBytes(location, segment.GetEnd(), &bytes);
+    if (length == 0) {
       return segment.GetEnd();
     }
-    if (validated_byte.value == Byte(value)) {
-      return location;
-    }
-    if (!std::isspace(validated_byte.value)) {
-      return segment.GetEnd();
+    for (size_t index = 0; index < length; ++index) {
+      if (bytes[index] == Byte(value)) {
+        return location + index;
+      }
+      if (!std::isspace(bytes[index])) {
+        return segment.GetEnd();
+      }
     }
+    location += length;
   }
   return segment.GetEnd();
 }
@@ -48,15 +52,40 @@ size_t JpegSegment::GetVariablePayloadSize() const {
   return static_cast<size_t>(hi.value) << 8 | static_cast<size_t>(lo.value);
 }
 
+size_t JpegSegment::GetContiguousBytes(size_t location, size_t end_location,
+                                       const Byte** bytes) const {
+  for (const DataSegment* segment : {begin_segment_, end_segment_}) {
+    if (segment && segment->Contains(location) && location < end_location) {
+      *bytes = segment->GetBuffer(location);
+      return std::min(end_location, segment->GetEnd()) - location;
+    }
+  }
+  *bytes = nullptr;
+  return 0;
+}
+
 bool JpegSegment::BytesAtLocationStartWith(size_t location,
                                            const char* str) const {
-  while (*str && Contains(location)) {
-    ValidatedByte validated_byte = GetValidatedByte(location++);
-    if (!validated_byte.is_valid || Byte(*str++) != validated_byte.value) {
+  size_t str_length = strlen(str);
+  if (str_length == 0) {
+    return true;
+  }
+  size_t end_location = location + str_length;
+  if (!Contains(location) || end_location > GetEnd()) {
+    return false;
+  }
+  // The comparison takes one memcmp() call, or two if the bytes straddle the
+  // underlying DataSegments.
+  while (location < end_location) {
+    const Byte* bytes = nullptr;
+    size_t length = GetContiguousBytes(location, end_location, &bytes);
+    if (length == 0 || memcmp(bytes, str, length) != 0) {
       return false;
     }
+    str += length;
+    location += length;
   }
-  return *str == 0;
+  return true;
 }
 
 bool JpegSegment::BytesAtLocationContain(size_t location,
@@ -127,47 +156,100 @@ size_t JpegSegment::FindXmpPropertyValueEnd(size_t start_location) const {
 std::string JpegSegment::ExtractString(const DataRange& data_range) const {
   std::string value;
   if (Contains(data_range.GetBegin()) && data_range.GetEnd() <= GetEnd()) {
-    size_t start_location = data_range.GetBegin();
-    size_t length = data_range.GetLength();
-    value.resize(length, ' ');
-    for (size_t index = 0; index < length; ++index) {
-      ValidatedByte validated_byte = GetValidatedByte(start_location + index);
-      if (!validated_byte.value) {  // Invalid bytes have a zero value.
-        value.resize(0);
-        break;
-      }
-      value[index] = static_cast<char>(validated_byte.value);
+    value.resize(data_range.GetLength());
+    Byte* bytes = reinterpret_cast<Byte*>(&value[0]);
+    // Invalid bytes have a zero value, so zero bytes make the string empty.
+    if (!CopyBytes(data_range, bytes) ||
+        memchr(bytes, 0, value.size()) != nullptr) {
+      value.resize(0);
     }
   }
   return value;
 }
 
+void JpegSegment::TokenizeXmpProperties(
+    const DataRange& data_range, XmpPropertyTokenizer* tokenizer) const {
+  size_t location = data_range.GetBegin();
+  for (const DataSegment* segment : {begin_segment_, end_segment_}) {
+    if (segment && location < data_range.GetEnd() &&
+        segment->Contains(location)) {
+      size_t end = std::min(data_range.GetEnd(), segment->GetEnd());
+      tokenizer->Tokenize(*segment, DataRange(location, end));
+      location = end;
+    }
+  }
+}
+
+std::shared_ptr<DataSegment> JpegSegment::ExtractDataSegment(
+    const DataRange& data_range) const {
+  if (!Contains(data_range.GetBegin()) || data_range.GetEnd() > GetEnd()) {
+    return nullptr;
+  }
+  // A view keeps all the memory of its parent allocated, so one is only made
+  // of a parent that has no more memory than its own bytes, and only if the
+  // range is at least half of them.
+  if (begin_segment_->GetDataRange().Contains(data_range) &&
+      begin_segment_->OwnsBuffer() && !begin_segment_->HasBufferOwner() &&
+      data_range.GetLength() >= begin_segment_->GetLength() / 2) {
+    auto view = DataSegment::CreateView(begin_segment_->weak_from_this().lock(),
+                                        data_range);
+    if (view) {
+      return view;
+    }
+  }
+  Byte* bytes = nullptr;
+  auto data_segment = DataSegment::CreateWithBuffer(data_range, &bytes);
+  return CopyBytes(data_range, bytes) ? data_segment : nullptr;
+}
+
+bool JpegSegment::CopyBytes(const DataRange& data_range, Byte* bytes) const {
+  size_t location = data_range.GetBegin();
+  while (location < data_range.GetEnd()) {
+    const Byte* span_bytes = nullptr;
+    size_t length =
+        GetContiguousBytes(location, data_range.GetEnd(), &span_bytes);
+    if (length == 0) {
+      return false;
+    }
+    memcpy(bytes, span_bytes, length);
+    bytes += length;
+    location += length;
+  }
+  return true;
+}
+
 void JpegSegment::GetPayloadHexDumpStrings(size_t byte_count,
                                            std::string* hex_string,
                                            std::string* ascii_string) const {
-  stringstream ascii_stream;
-  stringstream hex_stream;
-  hex_stream << std::hex << std::uppercase;
+  static const char kHexDigits[] = "0123456789ABCDEF";
+  hex_string->clear();
+  ascii_string->clear();
+  hex_string->reserve(2 * byte_count);
+  ascii_string->reserve(byte_count);
 
   size_t dump_count = GetMarker().IsEntropySegmentDelimiter()
                           ? byte_count
                           : std::min(byte_count, GetLength() - 2);
-  for (size_t index = 0; index < dump_count; ++index) {
-    ValidatedByte payload_byte = GetValidatedByte(GetPayloadLocation() + index);
-    if (!payload_byte.is_valid) {
+  size_t location = GetPayloadLocation();
+  size_t end_location = location + dump_count;
+  while (location < end_location) {
+    const Byte* bytes = nullptr;
+    size_t length = GetContiguousBytes(location, end_location, &bytes);
+    if (length == 0) {
       break;
     }
-    Byte value = payload_byte.value;
-    hex_stream << std::setfill('0') << std::setw(2) << static_cast<int>(value);
-    ascii_stream << (isprint(value) ? static_cast<char>(value) : '.');
+    for (size_t index = 0; index < length; ++index) {
+      Byte value = bytes[index];
+      hex_string->push_back(kHexDigits[value >> 4]);
+      hex_string->push_back(kHexDigits[value & 0xF]);
+      ascii_string->push_back(isprint(value) ? static_cast<char>(value) : '.');
+    }
+    location += length;
   }
-  size_t current_count = ascii_stream.str().length();
-  for (size_t index = current_count; index < byte_count; ++index) {
-    hex_stream << "  ";
-    ascii_stream << ".";
+  for (size_t index = ascii_string->length(); index < byte_count; ++index) {
+    hex_string->append("  ");
+    ascii_string->push_back('.');
   }
-  *hex_string = hex_stream.str();
-  *ascii_string = ascii_stream.str();
 }
 
 }  // namespace image_io
@@ -1,41 +1,125 @@
 #include "image_io/jpeg/jpeg_xmp_info_builder.h"
 
+#include <algorithm>
 #include <string>
 
 namespace photos_editing_formats {
 namespace image_io {
 
+using std::vector;
+
+namespace {
+
+/// @param segment The segment from which to read the value.
+/// @param location The location of the big endian 32 bit value.
+/// @return The value, or 0 if the segment does not contain all its bytes.
+size_t GetUInt32(const JpegSegment& segment, size_t location) {
+  size_t value = 0;
+  for (size_t index = 0; index < sizeof(std::uint32_t); ++index) {
+    ValidatedByte validated_byte = segment.GetValidatedByte(location + index);
+    if (!validated_byte.is_valid) {
+      return 0;
+    }
+    value = value << 8 | validated_byte.value;
+  }
+  return value;
+}
+
+}  // namespace
+
 void JpegXmpInfoBuilder::ProcessSegment(const JpegSegment& segment) {
-  // If the property has not yet been found, look for it, and if found, add the
-  // segment's range to the vector of ranges.
+  // The extended xmp header is made of the extended xmp id, the guid, the full
+  // length of the xmp packet and the offset of this segment's chunk in it.
+  size_t payload_data_location = segment.GetPayloadDataLocation();
   size_t extended_xmp_data_begin =
-      segment.GetPayloadDataLocation() + kXmpExtendedHeaderSize;
-  size_t property_value_begin = extended_xmp_data_begin;
-  if (property_segment_ranges_.empty()) {
+      payload_data_location + kXmpExtendedHeaderSize;
+  if (extended_xmp_data_begin > segment.GetEnd()) {
+    return;
+  }
+  size_t full_length_location =
+      payload_data_location + sizeof(kXmpExtendedId) + kXmpGuidSize;
+  Chunk chunk;
+  chunk.segment_range = segment.GetDataRange();
+  chunk.data_location = extended_xmp_data_begin;
+  chunk.size = segment.GetEnd() - extended_xmp_data_begin;
+  chunk.full_length = GetUInt32(segment, full_length_location);
+  chunk.offset =
+      GetUInt32(segment, full_length_location + sizeof(std::uint32_t));
+  chunk.value_begin = chunk.size;
+
+  // If the property has not yet been found, look for it. Then look for the
+  // first quote that may end the property value in this chunk. Which of the
+  // quotes is the actual end can only be decided in Finish(), once the order
+  // of the chunks is known.
+  size_t quote_search_location = extended_xmp_data_begin;
+  if (!has_value_begin_) {
     std::string property_name =
         JpegXmpInfo::GetDataPropertyName(xmp_info_type_);
-    property_value_begin = segment.FindXmpPropertyValueBegin(
+    size_t property_value_begin = segment.FindXmpPropertyValueBegin(
         extended_xmp_data_begin, property_name.c_str());
     if (property_value_begin != segment.GetEnd()) {
-      property_segment_ranges_.push_back(segment.GetDataRange());
+      chunk.value_begin = property_value_begin - extended_xmp_data_begin;
+      quote_search_location = property_value_begin;
+      has_value_begin_ = true;
     }
-  } else if (!property_end_segment_range_.IsValid()) {
-    // The start of the property value was encountered in a previous segment -
-    // if the closing quote has not yet been found, then add the segment's range
-    // to the vector or ranges.
-    property_segment_ranges_.push_back(segment.GetDataRange());
   }
+  chunk.quote = segment.FindXmpPropertyValueEnd(quote_search_location) -
+                extended_xmp_data_begin;
+  chunks_.push_back(chunk);
+}
+
+void JpegXmpInfoBuilder::Finish() {
+  property_segment_ranges_.clear();
+  property_value_ranges_.clear();
+
+  // Put the chunks in xmp packet order. If the offsets in the segments don't
+  // make sense, fall back to the order in which the segments were processed.
+  vector<Chunk> chunks = chunks_;
+  std::stable_sort(chunks.begin(), chunks.end(),
+                   [](const Chunk& lhs, const Chunk& rhs) {
+                     return lhs.offset < rhs.offset;
+                   });
+  if (!HaveConsistentChunkOffsets(chunks)) {
+    chunks = chunks_;
+  }
+
+  // Starting with the chunk that has the begin of the property value, add the
+  // segment range of the chunks to the vector of ranges, along with the part of
+  // their data that is in the property value, up to the closing quote.
+  auto chunk_iter =
+      std::find_if(chunks.begin(), chunks.end(), [](const Chunk& chunk) {
+        return chunk.value_begin < chunk.size;
+      });
+  size_t value_begin = chunk_iter != chunks.end() ? chunk_iter->value_begin : 0;
+  for (; chunk_iter != chunks.end(); ++chunk_iter) {
+    property_segment_ranges_.push_back(chunk_iter->segment_range);
+    size_t value_end = std::min(chunk_iter->quote, chunk_iter->size);
+    if (value_begin < value_end) {
+      property_value_ranges_.emplace_back(
+          chunk_iter->data_location + value_begin,
+          chunk_iter->data_location + value_end);
+    }
+    if (chunk_iter->quote < chunk_iter->size) {
+      return;
+    }
+    value_begin = 0;
+  }
+
+  // The closing quote was not found, so the value is incomplete.
+  property_value_ranges_.clear();
+}
 
-  // If the start of the property value has been found but the end has not, look
-  // for the end in this segment.
-  if (!property_segment_ranges_.empty() &&
-      !property_end_segment_range_.IsValid()) {
-    size_t property_value_end =
-        segment.FindXmpPropertyValueEnd(property_value_begin);
-    if (property_value_end != segment.GetEnd()) {
-      property_end_segment_range_ = segment.GetDataRange();
+bool JpegXmpInfoBuilder::HaveConsistentChunkOffsets(
+    const vector<Chunk>& chunks) {
+  size_t next_offset = 0;
+  for (const auto& chunk : chunks) {
+    if (chunk.offset != next_offset ||
+        chunk.full_length != chunks.front().full_length) {
+      return false;
     }
+    next_offset += chunk.size;
   }
+  return !chunks.empty() && next_offset == chunks.front().full_length;
 }
 
 }  // namespace image_io
@@ -61,10 +61,10 @@ std::shared_ptr<DataSegment> ReadEntireFile(const std::string& file_name,
     unique_ptr<istream> shared_istream =
         OpenInputFile(file_name, message_handler);
     if (shared_istream) {
-      Byte* buffer = new Byte[buffer_size];
+      Byte* buffer = nullptr;
+      shared_data_segment =
+          DataSegment::CreateWithBuffer(DataRange(0, buffer_size), &buffer);
       if (buffer) {
-        shared_data_segment =
-            DataSegment::Create(DataRange(0, buffer_size), buffer);
         shared_istream->read(reinterpret_cast<char*>(buffer), buffer_size);
         size_t bytes_read = shared_istream->tellg();
         if (bytes_read != buffer_size) {
@@ -0,0 +1,101 @@
+#include "image_io/utils/thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace photos_editing_formats {
+namespace image_io {
+
+ThreadPool::ThreadPool(size_t thread_count)
+    : queued_task_count_(0),
+      unfinished_task_count_(0),
+      next_queue_index_(0),
+      is_stopping_(false) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1U);
+  }
+  for (size_t index = 0; index < thread_count; ++index) {
+    queues_.emplace_back(new WorkerQueue);  // NOLINT
+  }
+  for (size_t index = 0; index < thread_count; ++index) {
+    threads_.emplace_back(&ThreadPool::RunWorker, this, index);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  task_available_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Submit(Task task) {
+  {
+    // The task is queued while holding mutex_, which TakeTask() needs in order
+    // to decrement the count, so the count never drops below zero.
+    std::lock_guard<std::mutex> lock(mutex_);
+    WorkerQueue* queue = queues_[next_queue_index_].get();
+    next_queue_index_ = (next_queue_index_ + 1) % queues_.size();
+    std::lock_guard<std::mutex> queue_lock(queue->mutex);
+    queue->tasks.push_back(std::move(task));
+    ++queued_task_count_;
+    ++unfinished_task_count_;
+  }
+  task_available_.notify_one();
+}
+
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  tasks_finished_.wait(lock, [this]() { return unfinished_task_count_ == 0; });
+}
+
+void ThreadPool::RunWorker(size_t worker_index) {
+  while (true) {
+    Task task;
+    if (TakeTask(worker_index, &task)) {
+      task(worker_index);
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (--unfinished_task_count_ == 0) {
+        tasks_finished_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_available_.wait(lock, [this]() {
+      return queued_task_count_ > 0 || is_stopping_;
+    });
+    if (queued_task_count_ == 0 && is_stopping_) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::TakeTask(size_t worker_index, Task* task) {
+  size_t queue_count = queues_.size();
+  for (size_t offset = 0; offset < queue_count; ++offset) {
+    WorkerQueue* queue = queues_[(worker_index + offset) % queue_count].get();
+    std::unique_lock<std::mutex> queue_lock(queue->mutex);
+    if (queue->tasks.empty()) {
+      continue;
+    }
+    if (offset == 0) {
+      *task = std::move(queue->tasks.back());
+      queue->tasks.pop_back();
+    } else {
+      *task = std::move(queue->tasks.front());
+      queue->tasks.pop_front();
+    }
+    queue_lock.unlock();
+    std::lock_guard<std::mutex> lock(mutex_);
+    --queued_task_count_;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
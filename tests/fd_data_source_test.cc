@@ -0,0 +1,63 @@
+#include "image_io/base/fd_data_source.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/message.h"
+#include "image_io/base/message_handler.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+namespace {
+
+TEST(FdDataSourceTest, ReadsBytesUntilTheEndOfTheFile) {
+  std::string file_name = ::testing::TempDir() + "fd_data_source_test.bin";
+  FILE* file = fopen(file_name.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  ASSERT_EQ(fputs("0123456789", file), 1);
+  ASSERT_EQ(fclose(file), 0);
+  int fd = open(file_name.c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+
+  MessageHandler message_handler;
+  message_handler.SetMessageWriter(nullptr);
+  FdDataSource data_source(fd, &message_handler);
+  auto data_segment = data_source.GetDataSegment(4, 100);
+  ASSERT_NE(data_segment, nullptr);
+  EXPECT_EQ(data_segment->GetDataRange(), DataRange(4, 10));
+  EXPECT_EQ(data_source.GetDataSegment(10, 100), nullptr);
+  EXPECT_FALSE(message_handler.HasErrorMessages());
+
+  close(fd);
+  remove(file_name.c_str());
+}
+
+TEST(FdDataSourceTest, ReportsReadErrors) {
+  // Reading a directory fails with EISDIR, rather than at the end of a file.
+  int fd = open(::testing::TempDir().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+
+  MessageHandler message_handler;
+  message_handler.SetMessageWriter(nullptr);
+  FdDataSource data_source(fd, &message_handler);
+  data_source.SetName("directory");
+  EXPECT_EQ(data_source.GetDataSegment(0, 100), nullptr);
+  std::vector<Message> messages = message_handler.GetMessages();
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0].GetType(), Message::kStdLibError);
+  EXPECT_EQ(messages[0].GetSystemErrno(), EISDIR);
+  EXPECT_EQ(messages[0].GetText(), "directory");
+
+  close(fd);
+}
+
+}  // namespace
+}  // namespace image_io
+}  // namespace photos_editing_formats
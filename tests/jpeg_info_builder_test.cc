@@ -0,0 +1,66 @@
+#include "image_io/jpeg/jpeg_info_builder.h"
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/data_segment_data_source.h"
+#include "image_io/jpeg/jpeg_info.h"
+#include "image_io/jpeg/jpeg_scanner.h"
+#include "image_io/jpeg/jpeg_xmp_info.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+namespace {
+
+/// @param xmp The XMP text of the file's primary XMP segment.
+/// @return The JpegInfo of a file with an APP1/XMP segment with the text.
+JpegInfo GetInfoOfFileWithXmp(const std::string& xmp) {
+  std::string payload = std::string(kXmpId, sizeof(kXmpId)) + xmp;
+  size_t length = payload.size() + 2;
+  std::string file = "\xFF\xD8\xFF\xE1";
+  file += static_cast<char>(length >> 8);
+  file += static_cast<char>(length & 0xFF);
+  file += payload + "\xFF\xD9";
+
+  Byte* buffer = nullptr;
+  auto data_segment =
+      DataSegment::CreateWithBuffer(DataRange(0, file.size()), &buffer);
+  memcpy(buffer, file.data(), file.size());
+  DataSegmentDataSource data_source(data_segment);
+  JpegInfoBuilder info_builder;
+  JpegScanner scanner(nullptr);
+  scanner.Run(&data_source, &info_builder);
+  return info_builder.GetInfo();
+}
+
+TEST(JpegInfoBuilderTest, FindsGDepthMimeType) {
+  JpegInfo info = GetInfoOfFileWithXmp(
+      std::string("<rdf:Description xmlns:GDepth=\"") + kXmpGDepthV1Id +
+      "\" GDepth:Mime=\"image/jpeg\"/>");
+  EXPECT_EQ(info.GetMimeType(JpegXmpInfo::kGDepthInfoType), "image/jpeg");
+}
+
+TEST(JpegInfoBuilderTest, FindsGDepthMimeTypeWithCorruptedNamespace) {
+  // The equals sign of the namespace declaration is replaced by a stray byte,
+  // so the namespace is only found by searching the segment's bytes.
+  JpegInfo info = GetInfoOfFileWithXmp(
+      std::string("<rdf:Description xmlns:GDepth\xFF\"") + kXmpGDepthV1Id +
+      "\" GDepth:Mime=\"image/jpeg\"/>");
+  EXPECT_EQ(info.GetMimeType(JpegXmpInfo::kGDepthInfoType), "image/jpeg");
+}
+
+TEST(JpegInfoBuilderTest, FindsGDepthMimeTypeWithCorruptedAttribute) {
+  // The equals sign of the mime type attribute is replaced by a space.
+  JpegInfo info = GetInfoOfFileWithXmp(
+      std::string("<rdf:Description xmlns:GDepth=\"") + kXmpGDepthV1Id +
+      "\" GDepth:Near \"1.5\" GImage:Mime \"image/png\" "
+      "GDepth:Mime=\"image/jpeg\"/>");
+  EXPECT_EQ(info.GetMimeType(JpegXmpInfo::kGDepthInfoType), "image/jpeg");
+}
+
+}  // namespace
+}  // namespace image_io
+}  // namespace photos_editing_formats
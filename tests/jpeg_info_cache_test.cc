@@ -0,0 +1,64 @@
+#include "image_io/jpeg/jpeg_info_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "image_io/base/data_range.h"
+#include "image_io/jpeg/jpeg_info.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+namespace {
+
+/// Creates a file and sets its modification time.
+/// @param file_name The name of the file to create.
+/// @param seconds The seconds part of the modification time, which may be
+///     before the epoch.
+/// @param nanoseconds The nanoseconds part of the modification time.
+/// @return Whether the file was created and its time set.
+bool CreateFileWithTime(const std::string& file_name, time_t seconds,
+                        long nanoseconds) {  // NOLINT
+  FILE* file = fopen(file_name.c_str(), "wb");
+  if (!file || fputs("JPEG", file) < 0 || fclose(file) != 0) {
+    return false;
+  }
+  struct timespec times[2];
+  times[0].tv_sec = times[1].tv_sec = seconds;
+  times[0].tv_nsec = times[1].tv_nsec = nanoseconds;
+  return utimensat(AT_FDCWD, file_name.c_str(), times, 0) == 0;
+}
+
+TEST(JpegInfoCacheTest, IdentifiesFilesModifiedBeforeTheEpoch) {
+  std::string file_name = ::testing::TempDir() + "jpeg_info_cache_test.jpg";
+  std::string index_file_name = file_name + ".index";
+  ASSERT_TRUE(CreateFileWithTime(file_name, -86400, 5));
+  JpegInfo info;
+  info.AddImageRange(DataRange(0, 4));
+
+  JpegInfoCache cache(nullptr);
+  ASSERT_TRUE(cache.Insert(file_name, info));
+  JpegInfo cached_info;
+  EXPECT_TRUE(cache.Lookup(file_name, &cached_info));
+  EXPECT_EQ(cached_info.GetImageRanges(), info.GetImageRanges());
+
+  ASSERT_TRUE(cache.Save(index_file_name));
+  JpegInfoCache loaded_cache(nullptr);
+  ASSERT_TRUE(loaded_cache.Load(index_file_name));
+  EXPECT_TRUE(loaded_cache.Lookup(file_name, nullptr));
+
+  ASSERT_TRUE(CreateFileWithTime(file_name, -86400, 6));
+  EXPECT_FALSE(cache.Lookup(file_name, nullptr));
+  EXPECT_FALSE(loaded_cache.Lookup(file_name, nullptr));
+
+  remove(index_file_name.c_str());
+  remove(file_name.c_str());
+}
+
+}  // namespace
+}  // namespace image_io
+}  // namespace photos_editing_formats
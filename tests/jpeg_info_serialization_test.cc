@@ -0,0 +1,114 @@
+#include "image_io/jpeg/jpeg_info_serialization.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/jpeg/jpeg_info.h"
+#include "image_io/jpeg/jpeg_segment_info.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+namespace {
+
+const Byte kSegmentBytes[] = {0xFF, 0xE1, 0x00, 0x03, 0x45};
+constexpr size_t kSegmentByteCount = sizeof(kSegmentBytes);
+
+/// Writes the binary form of a JpegInfo with one segment info that has the
+/// kSegmentBytes captured, and the given range, which need not be valid.
+/// @param begin The begin location of the segment info's range.
+/// @param end The end location of the segment info's range.
+/// @return The binary form.
+std::vector<Byte> SerializeWithSegmentRange(UInt64 begin, UInt64 end) {
+  const char kTag[] = "JINF";
+  std::vector<Byte> bytes(kTag, kTag + strlen(kTag));
+  SerializeJpegInfoNumber(2, &bytes);  // The version.
+  SerializeJpegInfoNumber(0, &bytes);  // The image range count.
+  SerializeJpegInfoNumber(1, &bytes);  // The segment info count.
+  SerializeJpegInfoNumber(0, &bytes);  // The image index.
+  SerializeJpegInfoNumber(begin, &bytes);
+  SerializeJpegInfoNumber(end, &bytes);
+  SerializeJpegInfoNumber(strlen(kExif), &bytes);
+  bytes.insert(bytes.end(), kExif, kExif + strlen(kExif));
+  SerializeJpegInfoNumber(kSegmentByteCount, &bytes);
+  bytes.insert(bytes.end(), kSegmentBytes, kSegmentBytes + kSegmentByteCount);
+  for (int index = 0; index < 4; ++index) {
+    SerializeJpegInfoNumber(0, &bytes);  // The Apple depth and matte ranges.
+  }
+  SerializeJpegInfoNumber(2, &bytes);  // The Xmp info type count.
+  for (int index = 0; index < 2; ++index) {
+    SerializeJpegInfoNumber(0, &bytes);  // The mime type.
+    SerializeJpegInfoNumber(0, &bytes);  // The segment data ranges.
+    SerializeJpegInfoNumber(0, &bytes);  // The value data ranges.
+  }
+  return bytes;
+}
+
+TEST(JpegInfoSerializationTest, RoundTripsCapturedSegmentBytes) {
+  Byte* buffer = nullptr;
+  DataRange data_range(20, 20 + kSegmentByteCount);
+  auto data_segment = DataSegment::CreateWithBuffer(data_range, &buffer);
+  memcpy(buffer, kSegmentBytes, kSegmentByteCount);
+  JpegSegmentInfo segment_info(0, data_range, kExif);
+  segment_info.SetDataSegment(data_segment);
+  JpegInfo info;
+  info.AddImageRange(DataRange(0, 100));
+  info.AddSegmentInfo(segment_info);
+
+  std::vector<Byte> bytes;
+  SerializeJpegInfo(info, &bytes);
+  JpegInfo read_info;
+  EXPECT_EQ(DeserializeJpegInfo(bytes.data(), bytes.size(), &read_info),
+            bytes.size());
+  EXPECT_EQ(read_info.GetImageRanges(), info.GetImageRanges());
+  EXPECT_EQ(read_info.GetSegmentInfos(), info.GetSegmentInfos());
+}
+
+TEST(JpegInfoSerializationTest, ReadsSegmentBytesMatchingTheRange) {
+  std::vector<Byte> bytes =
+      SerializeWithSegmentRange(20, 20 + kSegmentByteCount);
+  JpegInfo info;
+  ASSERT_EQ(DeserializeJpegInfo(bytes.data(), bytes.size(), &info),
+            bytes.size());
+  ASSERT_EQ(info.GetSegmentInfos().size(), 1);
+  EXPECT_EQ(info.GetSegmentInfos()[0].GetByteCount(), kSegmentByteCount);
+}
+
+TEST(JpegInfoSerializationTest, RejectsSegmentRangeThatWraps) {
+  std::vector<Byte> bytes = SerializeWithSegmentRange(~UInt64{0} - 1, 0);
+  JpegInfo info;
+  info.AddImageRange(DataRange(0, 100));
+  EXPECT_EQ(DeserializeJpegInfo(bytes.data(), bytes.size(), &info), 0);
+  EXPECT_EQ(info.GetImageRanges().size(), 1);
+}
+
+TEST(JpegInfoSerializationTest, RejectsSegmentRangeShorterThanBytes) {
+  std::vector<Byte> bytes = SerializeWithSegmentRange(~UInt64{0} - 1,
+                                                      ~UInt64{0});
+  JpegInfo info;
+  EXPECT_EQ(DeserializeJpegInfo(bytes.data(), bytes.size(), &info), 0);
+}
+
+TEST(JpegInfoSerializationTest, RejectsSegmentRangeLongerThanBytes) {
+  std::vector<Byte> bytes = SerializeWithSegmentRange(20, 40);
+  JpegInfo info;
+  EXPECT_EQ(DeserializeJpegInfo(bytes.data(), bytes.size(), &info), 0);
+}
+
+TEST(JpegInfoSerializationTest, RejectsSegmentRangeBeyondSizeMax) {
+  if (sizeof(size_t) >= sizeof(UInt64)) {
+    GTEST_SKIP() << "Every location fits in a size_t";
+  }
+  UInt64 begin = UInt64{SIZE_MAX} + 1;
+  std::vector<Byte> bytes =
+      SerializeWithSegmentRange(begin, begin + kSegmentByteCount);
+  JpegInfo info;
+  EXPECT_EQ(DeserializeJpegInfo(bytes.data(), bytes.size(), &info), 0);
+}
+
+}  // namespace
+}  // namespace image_io
+}  // namespace photos_editing_formats
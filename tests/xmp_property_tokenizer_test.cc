@@ -0,0 +1,92 @@
+#include "image_io/base/xmp_property_tokenizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+namespace {
+
+/// A processor that records the properties as prefix|name=value strings.
+class PropertyRecorder : public XmpPropertyProcessor {
+ public:
+  explicit PropertyRecorder(const std::string& text) : text_(text) {}
+
+  void Process(const XmpProperty& property) override {
+    std::string value;
+    for (const auto& range : property.value_ranges) {
+      value.append(text_, range.GetBegin(), range.GetLength());
+    }
+    properties_.push_back(property.prefix + "|" + property.name + "=" + value);
+  }
+
+  const std::vector<std::string>& GetProperties() const { return properties_; }
+
+ private:
+  const std::string& text_;
+  std::vector<std::string> properties_;
+};
+
+/// Tokenizes the text in pieces of the given size, each in its own segment.
+/// @param text The text to tokenize.
+/// @param piece_size The size of the pieces.
+/// @param has_skipped_malformed_markup Receives whether the tokenizer skipped
+///     malformed markup.
+/// @return The properties found, as recorded by the PropertyRecorder.
+std::vector<std::string> Tokenize(const std::string& text, size_t piece_size,
+                                  bool* has_skipped_malformed_markup) {
+  PropertyRecorder recorder(text);
+  XmpPropertyTokenizer tokenizer(&recorder);
+  for (size_t begin = 0; begin < text.size(); begin += piece_size) {
+    DataRange range(begin, std::min(text.size(), begin + piece_size));
+    Byte* buffer = nullptr;
+    auto data_segment = DataSegment::CreateWithBuffer(range, &buffer);
+    memcpy(buffer, text.data() + begin, range.GetLength());
+    tokenizer.Tokenize(*data_segment, range);
+  }
+  *has_skipped_malformed_markup = tokenizer.HasSkippedMalformedMarkup();
+  return recorder.GetProperties();
+}
+
+TEST(XmpPropertyTokenizerTest, FindsAttributesAndElements) {
+  std::string text =
+      "<?xpacket begin=''?><rdf:Description xmlns:GDepth=\"urn:depth\" "
+      "GDepth:Mime='image/jpeg'><GDepth:Near>1.5</GDepth:Near><x:y/>\n"
+      "</rdf:Description>";
+  std::vector<std::string> expected{"xmlns|GDepth=urn:depth",
+                                    "GDepth|Mime=image/jpeg",
+                                    "GDepth|Near=1.5"};
+  for (size_t piece_size : {text.size(), size_t{7}, size_t{1}}) {
+    bool has_skipped_malformed_markup = true;
+    EXPECT_EQ(Tokenize(text, piece_size, &has_skipped_malformed_markup),
+              expected);
+    EXPECT_FALSE(has_skipped_malformed_markup);
+  }
+}
+
+TEST(XmpPropertyTokenizerTest, RecoversFromCorruptedAttributes) {
+  std::string text =
+      "<rdf:Description GDepth:Format\xff=\"RangeInverse\" "
+      "xmlns:GDepth=\"urn:depth\" GDepth:Near \"1.5\" GDepth:Far= 2.5\" "
+      "GDepth:Mime=\"image/jpeg\" xmlns:GImage=\"urn:image\" "
+      "GImage:Mime=\"image/png\"/>";
+  std::vector<std::string> expected{
+      "xmlns|GDepth=urn:depth", "GDepth|Mime=image/jpeg",
+      "xmlns|GImage=urn:image", "GImage|Mime=image/png"};
+  for (size_t piece_size : {text.size(), size_t{5}, size_t{1}}) {
+    bool has_skipped_malformed_markup = false;
+    EXPECT_EQ(Tokenize(text, piece_size, &has_skipped_malformed_markup),
+              expected);
+    EXPECT_TRUE(has_skipped_malformed_markup);
+  }
+}
+
+}  // namespace
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,605 @@
+#include "synthetic_jpeg_generator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "image_io/base/byte_buffer.h"
+#include "image_io/jpeg/jpeg_marker.h"
+#include "image_io/jpeg/jpeg_segment_builder.h"
+#include "image_io/jpeg/jpeg_segment_info.h"
+#include "image_io/jpeg/jpeg_xmp_info.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+using std::string;
+using std::vector;
+
+constexpr size_t SyntheticJpegGenerator::kExtendedXmpChunkSize;
+
+namespace {
+
+/// The markers of the segments between the APPn segments and the entropy
+/// coded data. Their payloads are zero filled.
+const Byte kDQT = 0xDB;
+const Byte kSOF0 = 0xC0;
+const Byte kDHT = 0xC4;
+
+/// The size of the buffer used to send the bytes to the destination.
+const size_t kWriteBufferSize = 0x10000;
+
+/// The guid used to link the primary and extended XMP segments.
+const char kGuid[] = "0123456789ABCDEF0123456789ABCDEF";
+
+/// The size of the MPF segment data before the MP entries: the TIFF header, the
+/// IFD entry count, three IFD entries and the next IFD offset.
+const size_t kMpfEntriesOffset = 8 + 2 + 3 * 12 + 4;
+
+/// The size of an MP entry in the MPF segment.
+const size_t kMpfEntrySize = 16;
+
+/// The seeds of the parts of the file, that are mixed with the spec's seed, so
+/// that each part has the same contents whatever the other parts are.
+enum PartSeed {
+  kPrimarySeed = 1,
+  kAppSegmentSeed,
+  kGDepthSeed,
+  kGImageSeed,
+  kAppleDepthSeed,
+  kAppleMatteSeed,
+  kOtherImageSeed,
+  kTrailingFileSeed = kOtherImageSeed + 0x1000,
+};
+
+/// A small deterministic pseudo random number generator.
+class Random {
+ public:
+  /// @param seed The seed of the spec.
+  /// @param part_seed The seed of the part of the file.
+  Random(std::uint32_t seed, std::uint32_t part_seed)
+      : state_(seed ^ (part_seed << 20) ^ 0x9E3779B9) {
+    if (state_ == 0) {
+      state_ = 1;
+    }
+  }
+
+  /// @return The next pseudo random byte value, which is never 0xFF, so that
+  ///     the bytes can be used as entropy coded data without byte stuffing.
+  Byte NextByte() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    Byte value = static_cast<Byte>(state_ & 0xFF);
+    return value == 0xFF ? 0xFE : value;
+  }
+
+ private:
+  std::uint32_t state_;
+};
+
+/// @param size The size of a JPEG like image that is base64 encoded.
+/// @return The size of the base64 encoded image.
+size_t GetBase64Size(size_t size) { return (size + 2) / 3 * 4; }
+
+/// @param marker_type The type of the marker.
+/// @return A builder with the marker of a segment without a payload.
+JpegSegmentBuilder GetMarkerBuilder(Byte marker_type) {
+  JpegSegmentBuilder builder;
+  builder.AddMarkerAndSize(marker_type, 0);
+  return builder;
+}
+
+/// @param marker_type The type of the segment's marker.
+/// @param id The ascii0 id at the start of the payload.
+/// @param hex_payload The rest of the payload, as hex digits.
+/// @return A builder with the segment.
+JpegSegmentBuilder GetIdSegmentBuilder(Byte marker_type, const char* id,
+                                       const string& hex_payload) {
+  JpegSegmentBuilder builder;
+  builder.AddMarkerAndSizePlaceholder(marker_type);
+  builder.AddByteData(ByteData(ByteData::kAscii0, id));
+  builder.AddByteData(ByteData(ByteData::kHex, hex_payload));
+  return builder;
+}
+
+/// @param properties The name/value pairs of the description's properties.
+/// @return A builder with a primary XMP segment.
+JpegSegmentBuilder GetXmpSegmentBuilder(
+    const vector<std::pair<string, string>>& properties) {
+  JpegSegmentBuilder builder;
+  builder.AddMarkerAndSizePlaceholder(JpegMarker::kAPP1);
+  builder.AddByteData(ByteData(ByteData::kAscii0, kXmpId));
+  builder.AddXmpAndRdfPrefixes();
+  for (const auto& property : properties) {
+    builder.AddXmpPropertyNameAndValue(" " + property.first, property.second);
+  }
+  builder.AddXmpAndRdfSuffixes();
+  return builder;
+}
+
+/// The writer of the bytes of a file. Small amounts of data are collected in a
+/// buffer that is sent to the destination when it is full. Without a
+/// destination, the writer just counts the bytes.
+class Writer {
+ public:
+  /// @param data_destination The destination of the bytes, or nullptr to just
+  ///     count them.
+  explicit Writer(DataDestination* data_destination)
+      : data_destination_(data_destination),
+        location_(0),
+        buffer_size_(0),
+        is_done_(false),
+        has_error_(false) {
+    if (data_destination_) {
+      buffer_.reset(new Byte[kWriteBufferSize]);  // NOLINT
+    }
+  }
+
+  /// @return Whether the bytes are only counted.
+  bool IsCounting() const { return data_destination_ == nullptr; }
+
+  /// @return The location of the next byte to write.
+  size_t GetLocation() const { return location_; }
+
+  /// @return Whether the destination returned a transfer error.
+  bool HasError() const { return has_error_; }
+
+  /// Counts bytes without writing them.
+  /// @param size The number of bytes to count.
+  void Count(size_t size) { location_ += size; }
+
+  /// @param bytes The bytes to write.
+  /// @param size The number of bytes to write.
+  void Write(const Byte* bytes, size_t size) {
+    while (size > 0) {
+      size_t write_size = GetWritableSize(size);
+      if (write_size && !IsCounting()) {
+        memcpy(&buffer_[buffer_size_], bytes, write_size);
+      }
+      Commit(write_size);
+      bytes += write_size;
+      size -= write_size;
+    }
+  }
+
+  /// @param bytes The bytes to write.
+  void Write(const string& bytes) {
+    Write(reinterpret_cast<const Byte*>(bytes.data()), bytes.size());
+  }
+
+  /// @param builder The builder with the byte data to write.
+  void Write(const JpegSegmentBuilder& builder) {
+    ByteBuffer byte_buffer(builder.GetByteData());
+    size_t size = byte_buffer.GetSize();
+    std::unique_ptr<Byte[]> bytes(byte_buffer.Release());
+    Write(bytes.get(), size);
+  }
+
+  /// @param builder The builder with the byte data of exactly one segment, the
+  ///     payload size of which is set from the size of the byte data.
+  void WriteSegment(const JpegSegmentBuilder& builder) {
+    ByteBuffer byte_buffer(builder.GetByteData());
+    JpegSegmentBuilder::SetPayloadSize(&byte_buffer);
+    size_t size = byte_buffer.GetSize();
+    std::unique_ptr<Byte[]> bytes(byte_buffer.Release());
+    Write(bytes.get(), size);
+  }
+
+  /// Writes pseudo random bytes, none of which is 0xFF.
+  /// @param size The number of bytes to write.
+  /// @param random The generator of the bytes.
+  void WriteRandom(size_t size, Random* random) {
+    while (size > 0) {
+      size_t write_size = GetWritableSize(size);
+      if (!IsCounting()) {
+        Byte* bytes = &buffer_[buffer_size_];
+        for (size_t index = 0; index < write_size; ++index) {
+          bytes[index] = random->NextByte();
+        }
+      }
+      Commit(write_size);
+      size -= write_size;
+    }
+  }
+
+  /// Sends the bytes in the buffer to the destination.
+  void Flush() {
+    if (IsCounting() || buffer_size_ == 0) {
+      return;
+    }
+    if (!is_done_) {
+      DataRange range(location_ - buffer_size_, location_);
+      auto data_segment =
+          DataSegment::Create(range, buffer_.get(), DataSegment::kDontDelete);
+      DataDestination::TransferStatus status =
+          data_destination_->Transfer(range, *data_segment);
+      if (status != DataDestination::kTransferOk) {
+        is_done_ = true;
+        has_error_ = status == DataDestination::kTransferError;
+      }
+    }
+    buffer_size_ = 0;
+  }
+
+ private:
+  /// @param size The number of bytes to write.
+  /// @return The number of them that can be written to the buffer now.
+  size_t GetWritableSize(size_t size) {
+    if (IsCounting()) {
+      return size;
+    }
+    if (buffer_size_ == kWriteBufferSize) {
+      Flush();
+    }
+    return std::min(size, kWriteBufferSize - buffer_size_);
+  }
+
+  /// @param size The number of bytes added to the buffer.
+  void Commit(size_t size) {
+    location_ += size;
+    if (!IsCounting()) {
+      buffer_size_ += size;
+    }
+  }
+
+  DataDestination* data_destination_;
+  std::unique_ptr<Byte[]> buffer_;
+  size_t location_;
+  size_t buffer_size_;
+  bool is_done_;
+  bool has_error_;
+};
+
+/// The xmp packet of the extended XMP segments, made of text and of JPEG like
+/// images that are base64 encoded as the packet is written.
+class ExtendedXmpPacket {
+ public:
+  explicit ExtendedXmpPacket(std::uint32_t seed)
+      : seed_(seed), part_index_(0), image_location_(0), pending_offset_(0) {}
+
+  /// @param text Text to add to the packet.
+  void AddText(const string& text) { parts_.emplace_back(text, 0, 0); }
+
+  /// @param size The size of a JPEG like image to add to the packet.
+  /// @param part_seed The seed of the image's data.
+  void AddImage(size_t size, std::uint32_t part_seed) {
+    parts_.emplace_back("", std::max(size, static_cast<size_t>(4)),
+                        part_seed);
+  }
+
+  /// @return The size of the packet.
+  size_t GetSize() const {
+    size_t size = 0;
+    for (const auto& part : parts_) {
+      size += part.image_size ? GetBase64Size(part.image_size)
+                              : part.text.size();
+    }
+    return size;
+  }
+
+  /// Writes the next bytes of the packet.
+  /// @param size The number of bytes to write.
+  /// @param writer The writer to write them to.
+  void Write(size_t size, Writer* writer);
+
+ private:
+  struct Part {
+    Part(const string& a_text, size_t an_image_size, std::uint32_t a_seed)
+        : text(a_text), image_size(an_image_size), seed(a_seed) {}
+    string text;
+    size_t image_size;
+    std::uint32_t seed;
+  };
+
+  /// Puts the next bytes of the packet in the pending string.
+  /// @return Whether there were more bytes in the packet.
+  bool FillPending();
+
+  /// @param size The size of the image.
+  /// @param random The generator of the image's entropy coded data.
+  /// @return The next byte of the image being encoded.
+  Byte GetNextImageByte(size_t size, Random* random) {
+    size_t location = image_location_++;
+    if (location < JpegMarker::kLength) {
+      return location == 0 ? JpegMarker::kStart : JpegMarker::kSOI;
+    }
+    if (location >= size - JpegMarker::kLength) {
+      return location == size - 2 ? JpegMarker::kStart : JpegMarker::kEOI;
+    }
+    return random->NextByte();
+  }
+
+  std::uint32_t seed_;
+  vector<Part> parts_;
+  size_t part_index_;
+  size_t image_location_;
+  std::unique_ptr<Random> image_random_;
+  string pending_;
+  size_t pending_offset_;
+};
+
+void ExtendedXmpPacket::Write(size_t size,
+                              Writer* writer) {
+  if (writer->IsCounting()) {
+    writer->Count(size);
+    return;
+  }
+  while (size > 0) {
+    if (pending_offset_ == pending_.size() && !FillPending()) {
+      return;
+    }
+    size_t write_size = std::min(size, pending_.size() - pending_offset_);
+    writer->Write(
+        reinterpret_cast<const Byte*>(&pending_[pending_offset_]), write_size);
+    pending_offset_ += write_size;
+    size -= write_size;
+  }
+}
+
+bool ExtendedXmpPacket::FillPending() {
+  const char kBase64Chars[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const size_t kEncodeSize = 3 * 1024;
+  pending_.clear();
+  pending_offset_ = 0;
+  if (part_index_ == parts_.size()) {
+    return false;
+  }
+  const Part& part = parts_[part_index_];
+  if (!part.image_size) {
+    pending_ = part.text;
+    ++part_index_;
+    return true;
+  }
+  if (!image_random_) {
+    image_random_.reset(new Random(seed_, part.seed));  // NOLINT
+    image_location_ = 0;
+  }
+  size_t encode_end = std::min(image_location_ + kEncodeSize, part.image_size);
+  while (image_location_ < encode_end) {
+    size_t byte_count = std::min(encode_end - image_location_,
+                                 static_cast<size_t>(3));
+    std::uint32_t bits = 0;
+    for (size_t index = 0; index < 3; ++index) {
+      bits = bits << 8 |
+             (index < byte_count
+                  ? GetNextImageByte(part.image_size, image_random_.get())
+                  : 0);
+    }
+    for (size_t index = 0; index < 4; ++index) {
+      pending_ += index <= byte_count
+                      ? kBase64Chars[(bits >> (18 - 6 * index)) & 0x3F]
+                      : '=';
+    }
+  }
+  if (image_location_ == part.image_size) {
+    image_random_.reset();
+    ++part_index_;
+  }
+  return true;
+}
+
+/// A destination that copies the bytes to a buffer.
+class BufferDataDestination : public DataDestination {
+ public:
+  explicit BufferDataDestination(Byte* buffer)
+      : buffer_(buffer), bytes_transferred_(0) {}
+  void StartTransfer() override {}
+  TransferStatus Transfer(const DataRange& transfer_range,
+                          const DataSegment& data_segment) override {
+    memcpy(buffer_ + transfer_range.GetBegin(),
+           data_segment.GetBuffer(transfer_range.GetBegin()),
+           transfer_range.GetLength());
+    bytes_transferred_ += transfer_range.GetLength();
+    return kTransferOk;
+  }
+  void FinishTransfer() override {}
+  size_t GetBytesTransferred() const override { return bytes_transferred_; }
+
+ private:
+  Byte* buffer_;
+  size_t bytes_transferred_;
+};
+
+}  // namespace
+
+SyntheticJpegGenerator::SyntheticJpegGenerator(const SyntheticJpegSpec& spec)
+    : spec_(spec) {
+  SyntheticJpegLayout layout;
+  Write(nullptr, &layout);
+  layout_ = layout;
+}
+
+bool SyntheticJpegGenerator::Generate(DataDestination* data_destination,
+                                      MessageHandler* message_handler) const {
+  data_destination->StartTransfer();
+  SyntheticJpegLayout layout;
+  bool success = Write(data_destination, &layout);
+  data_destination->FinishTransfer();
+  if (!success && message_handler) {
+    message_handler->ReportMessage(Message::kInternalError,
+                                   "Synthetic JPEG transfer error");
+  }
+  return success;
+}
+
+std::shared_ptr<DataSegment> SyntheticJpegGenerator::GenerateDataSegment()
+    const {
+  Byte* buffer = nullptr;
+  auto data_segment =
+      DataSegment::CreateWithBuffer(DataRange(0, layout_.file_size), &buffer);
+  BufferDataDestination data_destination(buffer);
+  Generate(&data_destination, nullptr);
+  return data_segment;
+}
+
+bool SyntheticJpegGenerator::Write(DataDestination* data_destination,
+                                   SyntheticJpegLayout* layout) const {
+  Writer writer_object(data_destination);
+  Writer* writer = &writer_object;
+
+  // The parts of the file that are written with random data.
+  auto write_image_data = [&](size_t size, std::uint32_t part_seed) {
+    const std::pair<Byte, size_t> kSegments[] = {
+        {kDQT, 65}, {kSOF0, 17}, {kDHT, 30}, {JpegMarker::kSOS, 10}};
+    for (const auto& segment : kSegments) {
+      JpegSegmentBuilder builder;
+      builder.AddMarkerAndSize(segment.first, segment.second + 2);
+      builder.AddByteData(
+          ByteData(ByteData::kHex, string(2 * segment.second, '0')));
+      writer->Write(builder);
+    }
+    Random random(spec_.seed, part_seed);
+    writer->WriteRandom(size, &random);
+    writer->Write(GetMarkerBuilder(JpegMarker::kEOI));
+  };
+  auto write_secondary_image = [&](size_t size, const char* xmp_id,
+                                   std::uint32_t part_seed) {
+    size_t begin = writer->GetLocation();
+    writer->Write(GetMarkerBuilder(JpegMarker::kSOI));
+    if (xmp_id) {
+      writer->WriteSegment(GetXmpSegmentBuilder({{"xmlns:image_io", xmp_id}}));
+    }
+    write_image_data(size, part_seed);
+    return DataRange(begin, writer->GetLocation());
+  };
+
+  // The primary image, starting with the APP0/JFIF and APP1/Exif segments.
+  size_t primary_begin = writer->GetLocation();
+  writer->Write(GetMarkerBuilder(JpegMarker::kSOI));
+  writer->WriteSegment(GetIdSegmentBuilder(JpegMarker::kAPP0, kJfif,
+                                    "0102" "00" "0001" "0001" "00" "00"));
+  writer->WriteSegment(GetIdSegmentBuilder(JpegMarker::kAPP1, kExif,
+                                    "00" "4D4D002A00000008" "0000" "00000000"));
+
+  // The APP2/MPF segment lists the images in file order. Its values are taken
+  // from the layout_, so they are zero while the layout is being determined.
+  vector<DataRange> image_ranges = {layout_.primary_image_range};
+  if (spec_.apple_depth_image_size) {
+    image_ranges.push_back(layout_.apple_depth_image_range);
+  }
+  if (spec_.apple_matte_image_size) {
+    image_ranges.push_back(layout_.apple_matte_image_range);
+  }
+  for (size_t index = 0; index < spec_.other_image_sizes.size(); ++index) {
+    image_ranges.push_back(index < layout_.other_image_ranges.size()
+                               ? layout_.other_image_ranges[index]
+                               : DataRange());
+  }
+  if (image_ranges.size() > 1) {
+    // The offsets are relative to the TIFF header, which follows the marker,
+    // the size and the MPF id.
+    size_t tiff_location =
+        writer->GetLocation() + JpegMarker::kLength + 2 + sizeof(kMpf);
+    string mpf = "4D4D002A00000008" "0003";
+    mpf += "B000" "0007" "00000004" "30313030";
+    mpf += "B001" "0004" "00000001" + ByteData::Size2BigEndianHex(
+                                          image_ranges.size());
+    mpf += "B002" "0007" +
+           ByteData::Size2BigEndianHex(kMpfEntrySize * image_ranges.size()) +
+           ByteData::Size2BigEndianHex(kMpfEntriesOffset);
+    mpf += "00000000";
+    for (size_t index = 0; index < image_ranges.size(); ++index) {
+      const DataRange& range = image_ranges[index];
+      size_t offset = index > 0 && range.GetBegin() > tiff_location
+                          ? range.GetBegin() - tiff_location
+                          : 0;
+      mpf += index == 0 ? "20030000" : "00000000";
+      mpf += ByteData::Size2BigEndianHex(range.GetLength());
+      mpf += ByteData::Size2BigEndianHex(offset);
+      mpf += "0000" "0000";
+    }
+    writer->WriteSegment(GetIdSegmentBuilder(JpegMarker::kAPP2, kMpf, mpf));
+  }
+
+  // The primary and extended XMP segments with the GDepth and GImage images.
+  if (spec_.gdepth_image_size || spec_.gimage_image_size) {
+    vector<std::pair<string, string>> properties = {
+        {"xmlns:xmpNote", "http://ns.adobe.com/xmp/note/"},
+        {"xmpNote:HasExtendedXMP", kGuid}};
+    JpegSegmentBuilder prefix_builder;
+    prefix_builder.AddXmpAndRdfPrefixes();
+    JpegSegmentBuilder suffix_builder;
+    suffix_builder.AddXmpAndRdfSuffixes();
+    ExtendedXmpPacket packet(spec_.seed);
+    packet.AddText(prefix_builder.GetByteDataValues());
+    if (spec_.gdepth_image_size) {
+      properties.emplace_back("xmlns:GDepth", kXmpGDepthV1Id);
+      properties.emplace_back("GDepth:Mime", "image/jpeg");
+      packet.AddText(" GDepth:Data=\"");
+      packet.AddImage(spec_.gdepth_image_size, kGDepthSeed);
+      packet.AddText("\"");
+    }
+    if (spec_.gimage_image_size) {
+      properties.emplace_back("xmlns:GImage", kXmpGImageV1Id);
+      properties.emplace_back("GImage:Mime", "image/jpeg");
+      packet.AddText(" GImage:Data=\"");
+      packet.AddImage(spec_.gimage_image_size, kGImageSeed);
+      packet.AddText("\"");
+    }
+    packet.AddText(suffix_builder.GetByteDataValues());
+    writer->WriteSegment(GetXmpSegmentBuilder(properties));
+
+    size_t packet_size = packet.GetSize();
+    for (size_t offset = 0; offset < packet_size;
+         offset += kExtendedXmpChunkSize) {
+      size_t chunk_size = std::min(kExtendedXmpChunkSize, packet_size - offset);
+      JpegSegmentBuilder builder;
+      builder.AddMarkerAndSize(JpegMarker::kAPP1,
+                               2 + kXmpExtendedHeaderSize + chunk_size);
+      builder.AddByteData(ByteData(ByteData::kAscii0, kXmpExtendedId));
+      builder.AddByteData(ByteData(ByteData::kAscii, kGuid));
+      builder.AddByteData(ByteData(
+          ByteData::kHex, ByteData::Size2BigEndianHex(packet_size) +
+                              ByteData::Size2BigEndianHex(offset)));
+      writer->Write(builder);
+      packet.Write(chunk_size, writer);
+      ++layout->extended_xmp_segment_count;
+    }
+  }
+
+  // The extra APPn segments, with random payloads.
+  Random app_random(spec_.seed, kAppSegmentSeed);
+  size_t app_segment_size = std::min(spec_.app_segment_size,
+                                     static_cast<size_t>(0xFFFF - 2));
+  for (size_t index = 0; index < spec_.app_segment_count; ++index) {
+    JpegSegmentBuilder builder;
+    builder.AddMarkerAndSize(JpegMarker::kAPP2 + 1 + index % 13,
+                             app_segment_size + 2);
+    writer->Write(builder);
+    writer->WriteRandom(app_segment_size, &app_random);
+  }
+
+  write_image_data(spec_.primary_image_size, kPrimarySeed);
+  layout->primary_image_range =
+      DataRange(primary_begin, writer->GetLocation());
+
+  // The secondary images and the trailing files.
+  if (spec_.apple_depth_image_size) {
+    layout->apple_depth_image_range = write_secondary_image(
+        spec_.apple_depth_image_size, kXmpAppleDepthId, kAppleDepthSeed);
+  }
+  if (spec_.apple_matte_image_size) {
+    layout->apple_matte_image_range = write_secondary_image(
+        spec_.apple_matte_image_size, kXmpAppleMatteId, kAppleMatteSeed);
+  }
+  for (size_t index = 0; index < spec_.other_image_sizes.size(); ++index) {
+    layout->other_image_ranges.push_back(
+        write_secondary_image(spec_.other_image_sizes[index], nullptr,
+                              kOtherImageSeed + index));
+  }
+  for (size_t index = 0; index < spec_.trailing_file_sizes.size(); ++index) {
+    size_t begin = writer->GetLocation();
+    Random random(spec_.seed, kTrailingFileSeed + index);
+    writer->WriteRandom(spec_.trailing_file_sizes[index], &random);
+    layout->trailing_file_ranges.emplace_back(begin, writer->GetLocation());
+  }
+  layout->file_size = writer->GetLocation();
+  writer->Flush();
+  return !writer->HasError();
+}
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
@@ -0,0 +1,142 @@
+#ifndef IMAGE_IO_TOOLS_SYNTHETIC_JPEG_GENERATOR_H_  // NOLINT
+#define IMAGE_IO_TOOLS_SYNTHETIC_JPEG_GENERATOR_H_  // NOLINT
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "image_io/base/data_destination.h"
+#include "image_io/base/data_range.h"
+#include "image_io/base/data_segment.h"
+#include "image_io/base/message_handler.h"
+
+namespace photos_editing_formats {
+namespace image_io {
+
+/// The parameters of a synthetic JPEG file. The sizes of the images and files
+/// are the sizes of their entropy coded data or contents; the total size of
+/// the generated file is a bit larger because of the segments around them.
+struct SyntheticJpegSpec {
+  SyntheticJpegSpec()
+      : primary_image_size(0x10000),
+        app_segment_count(0),
+        app_segment_size(0),
+        gdepth_image_size(0),
+        gimage_image_size(0),
+        apple_depth_image_size(0),
+        apple_matte_image_size(0),
+        seed(1) {}
+
+  /// The size of the entropy coded data of the primary image.
+  size_t primary_image_size;
+
+  /// The number of extra APP3 to APP15 segments in the primary image.
+  size_t app_segment_count;
+
+  /// The payload size of each of the extra APPn segments, at most 65533.
+  size_t app_segment_size;
+
+  /// The size of the (JPEG like) GDepth image that is base64 encoded in the
+  /// GDepth:Data property of the extended XMP segments, or zero for none.
+  size_t gdepth_image_size;
+
+  /// The size of the GImage image in the GImage:Data property, or zero.
+  size_t gimage_image_size;
+
+  /// The size of the Apple depth secondary image, or zero for none.
+  size_t apple_depth_image_size;
+
+  /// The size of the Apple matte secondary image, or zero for none.
+  size_t apple_matte_image_size;
+
+  /// The sizes of other secondary images, that have no XMP segments.
+  std::vector<size_t> other_image_sizes;
+
+  /// The sizes of the files appended after the images, GContainer style.
+  std::vector<size_t> trailing_file_sizes;
+
+  /// The seed of the pseudo random contents of the images and files.
+  std::uint32_t seed;
+};
+
+/// The locations of the parts of a synthetic JPEG file.
+struct SyntheticJpegLayout {
+  SyntheticJpegLayout() : extended_xmp_segment_count(0), file_size(0) {}
+
+  /// The range of the primary image.
+  DataRange primary_image_range;
+
+  /// The range of the Apple depth image, if any.
+  DataRange apple_depth_image_range;
+
+  /// The range of the Apple matte image, if any.
+  DataRange apple_matte_image_range;
+
+  /// The ranges of the other secondary images.
+  std::vector<DataRange> other_image_ranges;
+
+  /// The ranges of the trailing files.
+  std::vector<DataRange> trailing_file_ranges;
+
+  /// The number of extended XMP segments in the primary image.
+  size_t extended_xmp_segment_count;
+
+  /// The size of the file.
+  size_t file_size;
+};
+
+/// SyntheticJpegGenerator generates deterministic JPEG files for performance
+/// testing, without the need for real photos. The primary image has APP0/JFIF,
+/// APP1/Exif and, if there are secondary images, APP2/MPF segments with the
+/// offsets and sizes of all the images. The optional GDepth and GImage images
+/// are base64 encoded into extended XMP segments, and the optional Apple depth
+/// and matte images follow the primary image, along with any other secondary
+/// images and trailing files. The segments are assembled with the
+/// JpegSegmentBuilder and ByteBuffer classes, while the bulk data is generated
+/// as it is written, so that files of any size can be streamed to a
+/// DataDestination in 64 KiB pieces.
+/// Note that the MPF offsets and sizes are 32 bit values, so they are only
+/// meaningful in files smaller than 4 GiB.
+class SyntheticJpegGenerator {
+ public:
+  /// The size of the xmp packet data in each extended XMP segment.
+  static constexpr size_t kExtendedXmpChunkSize = 65000;
+
+  /// @param spec The spec of the file to generate.
+  explicit SyntheticJpegGenerator(const SyntheticJpegSpec& spec);
+
+  /// @return The layout of the file to generate.
+  const SyntheticJpegLayout& GetLayout() const { return layout_; }
+
+  /// Generates the file and sends its bytes to the destination.
+  /// @param data_destination The destination of the bytes.
+  /// @param message_handler An optional message handler to write messages to.
+  /// @return Whether the file was generated without transfer errors.
+  bool Generate(DataDestination* data_destination,
+                MessageHandler* message_handler) const;
+
+  /// Generates the file in memory.
+  /// @return A data segment holding the file.
+  std::shared_ptr<DataSegment> GenerateDataSegment() const;
+
+ private:
+  /// Writes the file, or just determines its layout if there is no
+  /// destination. The layout_ must be set before the file is written, since
+  /// the MPF segment holds the offsets of the images.
+  /// @param data_destination The destination of the bytes, or nullptr.
+  /// @param layout The layout to fill in.
+  /// @return Whether the bytes were written without transfer errors.
+  bool Write(DataDestination* data_destination,
+             SyntheticJpegLayout* layout) const;
+
+  /// The spec of the file.
+  SyntheticJpegSpec spec_;
+
+  /// The layout of the file.
+  SyntheticJpegLayout layout_;
+};
+
+}  // namespace image_io
+}  // namespace photos_editing_formats
+
+#endif  // IMAGE_IO_TOOLS_SYNTHETIC_JPEG_GENERATOR_H_  // NOLINT
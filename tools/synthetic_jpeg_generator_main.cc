@@ -0,0 +1,170 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "image_io/base/fd_data_destination.h"
+#include "image_io/base/message_handler.h"
+#include "image_io/utils/string_outputter_message_writer.h"
+#include "synthetic_jpeg_generator.h"
+
+using photos_editing_formats::image_io::DataRange;
+using photos_editing_formats::image_io::FdDataDestination;
+using photos_editing_formats::image_io::Message;
+using photos_editing_formats::image_io::MessageHandler;
+using photos_editing_formats::image_io::StringOutputterMessageWriter;
+using photos_editing_formats::image_io::SyntheticJpegGenerator;
+using photos_editing_formats::image_io::SyntheticJpegLayout;
+using photos_editing_formats::image_io::SyntheticJpegSpec;
+using std::string;
+
+namespace {
+
+const char kUsage[] =
+    "Usage: synthetic_jpeg_generator [options] <output file, or - for stdout>\n"
+    "Options (sizes may have a K, M or G suffix):\n"
+    "  --primary_image_size=<size>      Size of the primary image data\n"
+    "  --app_segment_count=<count>      Number of extra APP3-APP15 segments\n"
+    "  --app_segment_size=<size>        Payload size of the extra segments\n"
+    "  --gdepth_image_size=<size>       Size of the extended XMP GDepth image\n"
+    "  --gimage_image_size=<size>       Size of the extended XMP GImage image\n"
+    "  --apple_depth_image_size=<size>  Size of the Apple depth image\n"
+    "  --apple_matte_image_size=<size>  Size of the Apple matte image\n"
+    "  --other_image_size=<size>        Size of another secondary image\n"
+    "                                   (repeatable)\n"
+    "  --trailing_file_size=<size>      Size of a trailing GContainer file\n"
+    "                                   (repeatable)\n"
+    "  --seed=<number>                  Seed of the pseudo random data\n"
+    "  --layout                         Writes the layout to stderr\n";
+
+/// @param value The text of a size, with an optional K, M or G suffix.
+/// @param size Receives the size.
+/// @return Whether the text is a valid size.
+bool ParseSize(const string& value, size_t* size) {
+  char* end = nullptr;
+  unsigned long long number = strtoull(value.c_str(), &end, 10);  // NOLINT
+  if (end == value.c_str()) {
+    return false;
+  }
+  string suffix(end);
+  int shift = suffix.empty() ? 0 : suffix == "K" ? 10 : suffix == "M" ? 20
+                                 : suffix == "G" ? 30 : -1;
+  if (shift < 0 || number > (~0ULL >> shift)) {
+    return false;
+  }
+  *size = static_cast<size_t>(number << shift);
+  return true;
+}
+
+/// @param name The name of the range.
+/// @param range The range to write to stderr, if valid.
+void WriteRange(const string& name, const DataRange& range) {
+  if (range.IsValid()) {
+    std::cerr << name << ": [" << range.GetBegin() << ", " << range.GetEnd()
+              << ")" << std::endl;
+  }
+}
+
+/// @param layout The layout to write to stderr.
+void WriteLayout(const SyntheticJpegLayout& layout) {
+  WriteRange("primary image", layout.primary_image_range);
+  WriteRange("apple depth image", layout.apple_depth_image_range);
+  WriteRange("apple matte image", layout.apple_matte_image_range);
+  for (const auto& range : layout.other_image_ranges) {
+    WriteRange("other image", range);
+  }
+  for (const auto& range : layout.trailing_file_ranges) {
+    WriteRange("trailing file", range);
+  }
+  std::cerr << "extended xmp segments: " << layout.extended_xmp_segment_count
+            << std::endl
+            << "file size: " << layout.file_size << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  SyntheticJpegSpec spec;
+  string output_file_name;
+  bool write_layout = false;
+  for (int index = 1; index < argc; ++index) {
+    string arg(argv[index]);
+    size_t equals = arg.find('=');
+    string name = arg.substr(0, equals);
+    string value = equals != string::npos ? arg.substr(equals + 1) : "";
+    size_t size = 0;
+    bool is_valid = true;
+    if (name == "--layout" && equals == string::npos) {
+      write_layout = true;
+    } else if (name.compare(0, 2, "--") != 0 || arg == "-") {
+      is_valid = output_file_name.empty();
+      output_file_name = arg;
+    } else if (!ParseSize(value, &size)) {
+      is_valid = false;
+    } else if (name == "--primary_image_size") {
+      spec.primary_image_size = size;
+    } else if (name == "--app_segment_count") {
+      spec.app_segment_count = size;
+    } else if (name == "--app_segment_size") {
+      spec.app_segment_size = size;
+    } else if (name == "--gdepth_image_size") {
+      spec.gdepth_image_size = size;
+    } else if (name == "--gimage_image_size") {
+      spec.gimage_image_size = size;
+    } else if (name == "--apple_depth_image_size") {
+      spec.apple_depth_image_size = size;
+    } else if (name == "--apple_matte_image_size") {
+      spec.apple_matte_image_size = size;
+    } else if (name == "--other_image_size") {
+      spec.other_image_sizes.push_back(size);
+    } else if (name == "--trailing_file_size") {
+      spec.trailing_file_sizes.push_back(size);
+    } else if (name == "--seed") {
+      spec.seed = static_cast<std::uint32_t>(size);
+    } else {
+      is_valid = false;
+    }
+    if (!is_valid) {
+      std::cerr << "Invalid argument: " << arg << std::endl << kUsage;
+      return EXIT_FAILURE;
+    }
+  }
+  if (output_file_name.empty()) {
+    std::cerr << kUsage;
+    return EXIT_FAILURE;
+  }
+
+  // The messages go to stderr, since the file may be written to stdout.
+  MessageHandler message_handler;
+  message_handler.SetMessageWriter(
+      std::unique_ptr<StringOutputterMessageWriter>(
+          new StringOutputterMessageWriter(  // NOLINT
+              [](const string& str) { std::cerr << str; })));
+  SyntheticJpegGenerator generator(spec);
+  if (write_layout) {
+    WriteLayout(generator.GetLayout());
+  }
+  bool is_stdout = output_file_name == "-";
+  int fd = is_stdout ? STDOUT_FILENO
+                     : open(output_file_name.c_str(),
+                            O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    message_handler.ReportMessage(Message::kStdLibError, output_file_name);
+    return EXIT_FAILURE;
+  }
+  bool success = false;
+  {
+    FdDataDestination data_destination(fd, &message_handler);
+    data_destination.SetName(output_file_name);
+    success = generator.Generate(&data_destination, &message_handler) &&
+              !data_destination.HasError();
+  }
+  if (!is_stdout && close(fd) != 0) {
+    message_handler.ReportMessage(Message::kStdLibError, output_file_name);
+    success = false;
+  }
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}